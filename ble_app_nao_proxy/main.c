@@ -67,6 +67,18 @@
 #include "nao_service_09.h"
 #include "nao_generic.h"
 #include "nao_proxychar.h"
+#include "nao_cache.h"
+#include "nao_poll.h"
+#include "nao_filter.h"
+#include "nao_scan_policy.h"
+#include "nao_conn_policy.h"
+#include "nao_phy.h"
+#include "nao_adv_policy.h"
+#include "nao_boot_prof.h"
+#include "nao_pipe.h"
+#include "nao_cyc.h"
+#include "nao_lat.h"
+#include "nao_stats.h"
 
 
 #define NAO_UUID_13 0xba,0x5c,0xf7,0x93,0x3b,0x12,0x16,0xb1,0xe4,0x11,0xb6,0x8a,0xf6,0x2b,0x17,0x13
@@ -85,10 +97,6 @@
 
 #define DEVICE_NAME                     "NAO Proxy"                                 /**< Name of device used for advertising. */
 #define MANUFACTURER_NAME               "woytekm"                       /**< Manufacturer. Passed to Device Information Service. */
-#define APP_ADV_INTERVAL                300                                         /**< The advertising interval (in units of 0.625 ms). This value corresponds to 187.5 ms. */
-
-#define APP_ADV_DURATION                18000                                       /**< The advertising duration (180 seconds) in units of 10 milliseconds. */
-
 #define APP_BLE_CONN_CFG_TAG            1                                           /**< Tag that identifies the SoftDevice BLE configuration. */
 
 #define FIRST_CONN_PARAMS_UPDATE_DELAY  APP_TIMER_TICKS(5000)                       /**< Time from initiating event (connect or start of notification) to the first time sd_ble_gap_conn_param_update is called (5 seconds). */
@@ -111,6 +119,10 @@
 #define CONFIG_FILE_ID                  0x11
 #define CONFIG_REC_KEY                  0x22
 
+#define HANDLE_CACHE_FILE_ID            0x12                                        /**< FDS file holding the NAO+ GATT handles of bonded lamps. */
+#define HANDLE_CACHE_REC_KEY_BASE       0x0100                                      /**< Record key of a bonded lamp is this plus its peer ID. */
+#define HANDLE_CACHE_VERSION            2
+
 /**@brief   Priority of the application BLE event handler.
  * @note    You shouldn't need to modify this value.
  */
@@ -118,8 +130,16 @@
 
 #define DB_DISCOVERY_INSTANCE_CNT       2  /**< Number of DB Discovery instances. */
 
+#define HOUSEKEEPING_INTERVAL_MS        200                                         /**< Period of the housekeeping timer. */
+
+#define NAO_LINGER_MS                   300000                                      /**< Time the NAO+ link is kept up after the watch disconnected (5 minutes), 0 drops it right away. */
+
+#define LOG_BENCH_COUNT                 64                                          /**< Packet path log calls timed by local command 0x4C. */
+#define BATCH_RESPONSE_TIMEOUT          APP_TIMER_TICKS(500)                        /**< Longest time responses to a batched command are held back before they are sent to the watch. */
+
 
 APP_TIMER_DEF(m_scheduler_timer_id);                                // timer for housekeeping routine which is not event-driven
+APP_TIMER_DEF(m_batch_timer_id);                                    // ends the hold on batched command responses
 
 NRF_BLE_GQ_DEF(m_ble_gatt_queue,                                    /**< BLE GATT Queue instance. */
                NRF_SDH_BLE_CENTRAL_LINK_COUNT,
@@ -176,6 +196,8 @@ static ble_uuid_t m_adv_uuids[] =
 };
 
 static uint8_t m_adv_handle = BLE_GAP_ADV_SET_HANDLE_NOT_SET;                   /**< Advertising handle used to identify an advertising set. */
+static ble_gap_addr_t m_watch_addr;                                            /**< Identity address of the last watch, target of directed advertising. */
+static bool           m_watch_addr_valid;
 static uint8_t m_enc_advdata[BLE_GAP_ADV_SET_DATA_SIZE_MAX];                    /**< Buffer for storing an encoded advertising set. */
 static uint8_t m_enc_scan_response_data[BLE_GAP_ADV_SET_DATA_SIZE_MAX];         /**< Buffer for storing an encoded scan data. */
 
@@ -207,7 +229,13 @@ static ble_gap_scan_params_t m_scan_param =                 /**< Scan parameters
 };
 
 
+static bool m_scan_active;  /**< Scanning for NAO+, the scan policy may change the duty cycle. */
+static bool m_identities_pending = true;  /**< Bonds changed, the device identity list has to be set again. */
+static volatile bool m_deferred_init_done;  /**< Lamp side initialized, see deferred_init(). */
+
 static void idle_state_handle(void);
+static void scan_start(void);
+static void bringup_unsent_retry(void);
 
 
 static void my_fds_evt_handler(fds_evt_t const * const p_fds_evt)
@@ -260,7 +288,7 @@ void apply_config(char *config_buffer)
   else
    {
     strcpy(m_target_periph_name,token);
-    NRF_LOG_INFO("setting NAO name to: %s",token);
+    NRF_LOG_INFO("setting NAO name to: %s",m_target_periph_name); // token is on the caller's stack, gone when the log is processed
    }
  }
 
@@ -331,6 +359,122 @@ uint8_t write_cfg_to_flash()
  }
 
 
+/**@brief NAO+ GATT handles of a bonded lamp, saved after a successful bring-up so reconnects can skip discovery. */
+typedef struct
+{
+    uint32_t                 version;
+    ble_gap_addr_t           id_addr;  // identity of the lamp the handles were discovered on
+    ble_nao_auth_c_handles_t auth;
+    ble_nao_stat_c_handles_t stat;
+    ble_nao_conf_c_handles_t conf;
+} handle_cache_t;
+
+static handle_cache_t m_handle_cache;  // FDS writes from this buffer, it has to stay valid until the write completes
+
+
+static bool peer_id_addr_get(pm_peer_id_t peer_id, ble_gap_addr_t * p_addr)
+ {
+  pm_peer_data_bonding_t bonding;
+
+  if(pm_peer_data_bonding_load(peer_id, &bonding) != NRF_SUCCESS)
+   return false;
+
+  *p_addr = bonding.peer_ble_id.id_addr_info;
+  return true;
+ }
+
+
+static bool handle_cache_load(pm_peer_id_t peer_id, handle_cache_t * p_cache)
+ {
+  fds_flash_record_t  flash_record;
+  fds_record_desc_t   record_desc;
+  fds_find_token_t    ftok;
+  ble_gap_addr_t      id_addr;
+  bool                found = false;
+
+  memset(&ftok, 0x00, sizeof(fds_find_token_t));
+
+  if(fds_record_find(HANDLE_CACHE_FILE_ID, HANDLE_CACHE_REC_KEY_BASE + peer_id, &record_desc, &ftok) != NRF_SUCCESS)
+   return false;
+
+  if(fds_record_open(&record_desc, &flash_record) != NRF_SUCCESS)
+   return false;
+
+  if(flash_record.p_header->length_words == (sizeof(handle_cache_t) + 3) / 4)
+   {
+    memcpy(p_cache, flash_record.p_data, sizeof(handle_cache_t));
+    found = (p_cache->version == HANDLE_CACHE_VERSION);
+   }
+
+  (void)fds_record_close(&record_desc);
+
+  // peer ids are reused after a bond is deleted, the record must belong to this very lamp
+  if(found && peer_id_addr_get(peer_id, &id_addr))
+   found = (p_cache->id_addr.addr_type == id_addr.addr_type) &&
+           (memcmp(p_cache->id_addr.addr, id_addr.addr, BLE_GAP_ADDR_LEN) == 0);
+  else
+   found = false;
+
+  // handles which discovery can never produce mean the record is unusable
+  return found &&
+         (p_cache->auth.nao_auth_rx_cccd_handle != BLE_GATT_HANDLE_INVALID) && (p_cache->auth.nao_auth_tx_handle != BLE_GATT_HANDLE_INVALID) &&
+         (p_cache->stat.nao_stat_rx_cccd_handle != BLE_GATT_HANDLE_INVALID) && (p_cache->stat.nao_stat_tx_handle != BLE_GATT_HANDLE_INVALID) &&
+         (p_cache->conf.nao_conf_rx_cccd_handle != BLE_GATT_HANDLE_INVALID) && (p_cache->conf.nao_conf_tx_handle != BLE_GATT_HANDLE_INVALID);
+ }
+
+
+static void handle_cache_store(pm_peer_id_t peer_id)
+ {
+  ret_code_t          ret;
+  fds_record_t        record;
+  fds_record_desc_t   record_desc;
+  fds_find_token_t    ftok;
+
+  if(!peer_id_addr_get(peer_id, &m_handle_cache.id_addr))
+   return;
+
+  m_handle_cache.version = HANDLE_CACHE_VERSION;
+  m_handle_cache.auth    = m_ble_nao_auth_c.handles;
+  m_handle_cache.stat    = m_ble_nao_stat_c.handles;
+  m_handle_cache.conf    = m_ble_nao_conf_c.handles;
+
+  record.file_id           = HANDLE_CACHE_FILE_ID;
+  record.key               = HANDLE_CACHE_REC_KEY_BASE + peer_id;
+  record.data.p_data       = &m_handle_cache;
+  record.data.length_words = (sizeof(handle_cache_t) + 3) / 4;
+
+  memset(&ftok, 0x00, sizeof(fds_find_token_t));
+
+  if(fds_record_find(HANDLE_CACHE_FILE_ID, record.key, &record_desc, &ftok) == NRF_SUCCESS)
+   ret = fds_record_update(&record_desc, &record);
+  else
+   ret = fds_record_write(&record_desc, &record);
+
+  if(ret != NRF_SUCCESS)
+   {
+    // the cache is optional, handles will be saved on the next bring-up
+    if(ret == FDS_ERR_NO_SPACE_IN_FLASH)
+     fds_gc();
+    NRF_LOG_WARNING("NAO+ handles not saved for peer %d: %d", peer_id, ret);
+    return;
+   }
+
+  NRF_LOG_INFO("NAO+ handles saved for peer %d", peer_id);
+ }
+
+
+static void handle_cache_delete(pm_peer_id_t peer_id)
+ {
+  fds_record_desc_t   record_desc;
+  fds_find_token_t    ftok;
+
+  memset(&ftok, 0x00, sizeof(fds_find_token_t));
+
+  while(fds_record_find(HANDLE_CACHE_FILE_ID, HANDLE_CACHE_REC_KEY_BASE + peer_id, &record_desc, &ftok) == NRF_SUCCESS)
+   fds_record_delete(&record_desc);
+ }
+
+
 
 volatile bool NAO_pair_now;
 volatile uint16_t NAO_pair_timer = 0;
@@ -339,11 +483,100 @@ volatile uint16_t NAO_conn_handle = BLE_CONN_HANDLE_INVALID;
 
 #define NAO_PAIR_TIMEOUT 20
 
+static bool m_conn_params_retry;  /**< A parameter update was refused while another was in progress. */
+
+static bool     m_linger_active;    /**< Watch gone, the NAO+ link is kept up until NAO_LINGER_MS has passed. */
+static uint32_t m_linger_start_ms;
+
+
+/**@brief Function for checking if a link went down before its BLE_GAP_EVT_DISCONNECTED was handled. */
+static bool err_is_link_gone(ret_code_t err_code)
+{
+    return (err_code == BLE_ERROR_INVALID_CONN_HANDLE) || (err_code == NRF_ERROR_INVALID_STATE);
+}
+
+
+/**@brief Function for applying the parameters of the current connection profile to both links.
+ *
+ * @details The lamp link is updated directly, as its central. For the watch link the parameters are
+ *          handed to the Connection Parameters module, which requests them from the watch.
+ */
+static void conn_params_apply(void)
+{
+    ret_code_t            err_code;
+    ble_gap_conn_params_t conn_params;
+
+    nao_conn_policy_params_get(nao_conn_policy_profile_get(), &conn_params);
+    m_conn_params_retry = false;
+
+    if(m_conn_handle_nao_c != BLE_CONN_HANDLE_INVALID)
+     {
+      err_code = sd_ble_gap_conn_param_update(m_conn_handle_nao_c, &conn_params);
+      if(err_code == NRF_ERROR_BUSY)
+       m_conn_params_retry = true;
+      else if(!err_is_link_gone(err_code))
+       APP_ERROR_CHECK(err_code);
+     }
+
+    if(m_nao_proxy.conn_handle != BLE_CONN_HANDLE_INVALID)
+     {
+      err_code = ble_conn_params_change_conn_params(m_nao_proxy.conn_handle, &conn_params);
+      if(err_code == NRF_ERROR_BUSY)
+       m_conn_params_retry = true;
+      else if(!err_is_link_gone(err_code))
+       APP_ERROR_CHECK(err_code);
+     }
+}
+
+
+/**@brief Function for requesting a PHY in both directions of a link.
+ */
+static void phy_request(nao_conn_link_t link, uint16_t conn_handle, uint8_t phy)
+{
+    ret_code_t     err_code;
+    ble_gap_phys_t phys =
+    {
+        .tx_phys = phy,
+        .rx_phys = phy,
+    };
+
+    err_code = sd_ble_gap_phy_update(conn_handle, &phys);
+    if(err_code == NRF_ERROR_BUSY)
+     return;  // another procedure runs, the lamp link asks again on its next RSSI report
+    if(err_is_link_gone(err_code))
+     return;  // an RSSI report raced the disconnect
+    APP_ERROR_CHECK(err_code);
+
+    nao_phy_request_sent(link, phy);
+}
+
+
 static void housekeeping_timer_handler(void * p_context)
  {
 
   ret_code_t err_code;
 
+  nao_cache_tick(HOUSEKEEPING_INTERVAL_MS);
+  nao_poll_process(nao_cache_time_ms());
+  bringup_unsent_retry();
+
+  if(m_scan_active && nao_scan_policy_process(nao_cache_time_ms()))
+   scan_start(); // next duty-cycle stage
+
+  if(nao_conn_policy_process(nao_cache_time_ms()) || m_conn_params_retry)
+   conn_params_apply();
+
+  if(m_linger_active && ((nao_cache_time_ms() - m_linger_start_ms) >= NAO_LINGER_MS))
+   {
+    NRF_LOG_INFO("Watch did not return, dropping NAO+ link");
+    m_linger_active = false;
+    if(m_conn_handle_nao_c != BLE_CONN_HANDLE_INVALID)
+     {
+      err_code = sd_ble_gap_disconnect(m_conn_handle_nao_c,BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+      APP_ERROR_CHECK(err_code);
+     }
+   }
+
   if(NAO_pair_now)
    {
     nrf_gpio_pin_toggle(MY_LED_3);  // flash led on proxy to indicate pairing window (press NAO knob briefly when proxy LED is flashing)
@@ -362,6 +595,471 @@ static void housekeeping_timer_handler(void * p_context)
 
  }
 
+/**@brief Function for sending batched command responses which have been held back.
+ */
+static void batch_timer_handler(void * p_context)
+{
+    UNUSED_PARAMETER(p_context);
+    nao_proxy_notif_release(&m_nao_proxy);
+}
+
+/**@brief NAO+ bring-up state. */
+typedef enum
+{
+    BRINGUP_IDLE,            /**< No NAO+ connected. */
+    BRINGUP_PENDING,         /**< Connected, CCCD and AUTH writes are queued as soon as the handles of their service are known. */
+    BRINGUP_READY            /**< All CCCD writes acknowledged and AUTH answered. */
+} bringup_state_t;
+
+#define BRINGUP_SRV_AUTH     0x01
+#define BRINGUP_SRV_STAT     0x02
+#define BRINGUP_SRV_CONF     0x04
+#define BRINGUP_SRV_ALL      (BRINGUP_SRV_AUTH | BRINGUP_SRV_STAT | BRINGUP_SRV_CONF)
+
+#define BRINGUP_AUTH_CCCD    BRINGUP_SRV_AUTH  /**< Service 0x13 CCCD write acknowledged. */
+#define BRINGUP_STAT_CCCD    BRINGUP_SRV_STAT  /**< Service 0x68 CCCD write acknowledged. */
+#define BRINGUP_CONF_CCCD    BRINGUP_SRV_CONF  /**< Service 0x09 CCCD write acknowledged. */
+#define BRINGUP_AUTH_ANSWER  0x08              /**< The lamp answered the AUTH password (0xAA or 0xA5). */
+#define BRINGUP_DONE_ALL     (BRINGUP_SRV_ALL | BRINGUP_AUTH_ANSWER)
+
+#define BRINGUP_AUTH_PASSWORD 0x10             /**< Write of the AUTH password, with the CCCD bits above the bring-up writes. */
+
+/**@brief Time from NAO+ connection to each bring-up milestone, in ms. 0 if not reached yet. */
+typedef struct
+{
+    uint32_t discovery_ms;
+    uint32_t auth_ms;
+    uint32_t ready_ms;
+    uint32_t telemetry_ms;
+} bringup_latency_t;
+
+static bringup_state_t   m_bringup_state = BRINGUP_IDLE;
+static bool              m_bringup_cached;  /**< Handles come from the handle cache, not from discovery. */
+static uint8_t           m_bringup_srv_found;
+static uint8_t           m_bringup_done;
+static uint8_t           m_bringup_retry;   /**< CCCD writes rejected for lack of security, queued again once the link is secured. */
+static uint8_t           m_bringup_unsent;  /**< Bring-up writes the TX queue had no room for, queued again by the housekeeping timer. */
+static uint32_t          m_bringup_connect_ticks;
+static bringup_latency_t m_bringup_latency;
+
+static void bringup_cccd_rsp(void * p_context, ble_evt_t const * p_ble_evt);
+
+
+static uint32_t bringup_elapsed_ms(void)
+{
+    uint32_t ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), m_bringup_connect_ticks);
+
+    return (uint32_t)(((uint64_t)ticks * 1000) / APP_TIMER_CLOCK_FREQ);
+}
+
+
+/**@brief Function for noting the result of queueing a bring-up write.
+ *
+ * @return The write if it has to be queued again, 0 otherwise.
+ */
+static uint8_t bringup_write_result(uint8_t write, ret_code_t err_code)
+{
+    if(err_code == NRF_SUCCESS)
+     return 0;
+
+    if(err_code == NRF_ERROR_NO_MEM)
+     return write;  // TX queue of the link is full, try again later
+
+    NRF_LOG_INFO("bring-up write 0x%x failed: %d", write, err_code);
+    return 0;
+}
+
+
+/**@brief Function for queueing bring-up writes: the CCCD writes of BRINGUP_*_CCCD and BRINGUP_AUTH_PASSWORD.
+ *
+ * @details All writes go into the NAO+ TX queue at once. The CCCD writes are write requests and
+ *          follow each other as soon as the previous one is acknowledged, the AUTH password is a
+ *          write command and is sent right behind the 0x13 CCCD write. Writes the TX queue has no
+ *          room for are kept in m_bringup_unsent.
+ */
+static void bringup_writes_issue(uint8_t writes)
+{
+    uint8_t unsent = 0;
+
+    if(writes & BRINGUP_AUTH_CCCD)
+     unsent |= bringup_write_result(BRINGUP_AUTH_CCCD, ble_nao_auth_c_rx_notif_enable(&m_ble_nao_auth_c));
+
+    if(writes & BRINGUP_AUTH_PASSWORD)
+     {
+      if(unsent & BRINGUP_AUTH_CCCD)
+       unsent |= BRINGUP_AUTH_PASSWORD;  // the answer would be lost without notifications
+      else
+       {
+        NRF_LOG_INFO("Sending AUTH password to service 0x13\r\n");
+        unsent |= bringup_write_result(BRINGUP_AUTH_PASSWORD, ble_nao_auth_c_send_auth(&m_ble_nao_auth_c));
+       }
+     }
+
+    if(writes & BRINGUP_STAT_CCCD)
+     unsent |= bringup_write_result(BRINGUP_STAT_CCCD, ble_nao_stat_c_rx_notif_enable(&m_ble_nao_stat_c));
+
+    if(writes & BRINGUP_CONF_CCCD)
+     unsent |= bringup_write_result(BRINGUP_CONF_CCCD, ble_nao_conf_c_rx_notif_enable(&m_ble_nao_conf_c));
+
+    m_bringup_unsent = (m_bringup_unsent & ~writes) | unsent;
+}
+
+
+/**@brief Function for queueing the bring-up writes again which found the TX queue full.
+ */
+static void bringup_unsent_retry(void)
+{
+    if((m_bringup_state == BRINGUP_PENDING) && (m_bringup_unsent != 0))
+     bringup_writes_issue(m_bringup_unsent);
+}
+
+
+/**@brief Function for handling the lamp ready event: notifications enabled on all three services and AUTH answered.
+ */
+static void on_lamp_ready(void)
+{
+    NRF_LOG_INFO("NAO+ lamp ready after %d ms (discovery %d ms, AUTH %d ms)",
+                 m_bringup_latency.ready_ms, m_bringup_latency.discovery_ms, m_bringup_latency.auth_ms);
+
+    if(m_nao_proxy.conn_handle != BLE_CONN_HANDLE_INVALID)
+     nao_poll_start(nao_cache_time_ms());  // polled values only matter to a watch
+
+    if(nao_conn_policy_bringup_set(false))
+     conn_params_apply();
+}
+
+
+static void bringup_ready_check(void)
+{
+    if((m_bringup_state != BRINGUP_PENDING) || (m_bringup_done != BRINGUP_DONE_ALL))
+     return;
+
+    m_bringup_state            = BRINGUP_READY;
+    m_bringup_latency.ready_ms = bringup_elapsed_ms();
+    on_lamp_ready();
+}
+
+
+/**@brief Function for starting the bring-up of a newly connected NAO+.
+ */
+static void bringup_start(void)
+{
+    m_bringup_state         = BRINGUP_PENDING;
+    m_bringup_srv_found     = 0;
+    m_bringup_done          = 0;
+    m_bringup_retry         = 0;
+    m_bringup_unsent        = 0;
+    m_bringup_cached        = false;
+    m_bringup_connect_ticks = app_timer_cnt_get();
+    memset(&m_bringup_latency, 0, sizeof(m_bringup_latency));
+
+    if(nao_conn_policy_bringup_set(true))
+     conn_params_apply();
+}
+
+
+/**@brief Function for noting NAO+ services with assigned handles, their writes are queued right away.
+ */
+static void bringup_service_found(uint8_t srv)
+{
+    ret_code_t err_code;
+
+    if(m_bringup_state != BRINGUP_PENDING)
+     return;
+
+    srv &= ~m_bringup_srv_found;
+    m_bringup_srv_found |= srv;
+
+    // Responses to the CCCD writes come back here, whatever else is written on the link.
+    if(srv & BRINGUP_SRV_AUTH)
+     {
+      err_code = nao_gattc_dispatch_register(m_ble_nao_auth_c.conn_handle, m_ble_nao_auth_c.handles.nao_auth_rx_cccd_handle, bringup_cccd_rsp, NULL);
+      APP_ERROR_CHECK(err_code);
+     }
+    if(srv & BRINGUP_SRV_STAT)
+     {
+      err_code = nao_gattc_dispatch_register(m_ble_nao_stat_c.conn_handle, m_ble_nao_stat_c.handles.nao_stat_rx_cccd_handle, bringup_cccd_rsp, NULL);
+      APP_ERROR_CHECK(err_code);
+     }
+    if(srv & BRINGUP_SRV_CONF)
+     {
+      err_code = nao_gattc_dispatch_register(m_ble_nao_conf_c.conn_handle, m_ble_nao_conf_c.handles.nao_conf_rx_cccd_handle, bringup_cccd_rsp, NULL);
+      APP_ERROR_CHECK(err_code);
+     }
+
+    bringup_writes_issue(srv | ((srv & BRINGUP_SRV_AUTH) ? BRINGUP_AUTH_PASSWORD : 0));
+
+    if(m_bringup_srv_found == BRINGUP_SRV_ALL)
+     {
+      m_bringup_latency.discovery_ms = bringup_elapsed_ms();
+      NRF_LOG_INFO("NAO+ services known after %d ms", m_bringup_latency.discovery_ms);
+     }
+}
+
+
+/**@brief Function for tracking the responses to the bring-up CCCD writes.
+ */
+static void bringup_write_rsp(ble_gattc_evt_t const * p_gattc_evt)
+{
+    uint16_t handle;
+    uint8_t  step = 0;
+
+    if((m_bringup_state != BRINGUP_PENDING) || (p_gattc_evt->conn_handle != m_conn_handle_nao_c))
+     return;
+
+    handle = (p_gattc_evt->gatt_status == BLE_GATT_STATUS_SUCCESS) ? p_gattc_evt->params.write_rsp.handle
+                                                                  : p_gattc_evt->error_handle;
+
+    if(handle == m_ble_nao_auth_c.handles.nao_auth_rx_cccd_handle)
+     step = BRINGUP_AUTH_CCCD;
+    else if(handle == m_ble_nao_stat_c.handles.nao_stat_rx_cccd_handle)
+     step = BRINGUP_STAT_CCCD;
+    else if(handle == m_ble_nao_conf_c.handles.nao_conf_rx_cccd_handle)
+     step = BRINGUP_CONF_CCCD;
+
+    if(step == 0)
+     return;
+
+    if(p_gattc_evt->gatt_status == BLE_GATT_STATUS_SUCCESS)
+     {
+      m_bringup_done |= step;
+      bringup_ready_check();
+     }
+    else if((p_gattc_evt->gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION) ||
+            (p_gattc_evt->gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION))
+     {
+      NRF_LOG_INFO("CCCD 0x%x needs a secured link, retried after pairing", handle);
+      m_bringup_retry |= step;
+     }
+    else
+     {
+      NRF_LOG_INFO("CCCD 0x%x write failed: 0x%x", handle, p_gattc_evt->gatt_status);
+     }
+}
+
+
+/**@brief Function for queueing the CCCD writes again which failed before the link was secured.
+ *
+ * @details Only the CCCD writes, the AUTH password went out with the first attempt.
+ */
+static void bringup_conn_secured(uint16_t conn_handle)
+{
+    if((m_bringup_state != BRINGUP_PENDING) || (conn_handle != m_conn_handle_nao_c) || (m_bringup_retry == 0))
+     return;
+
+    bringup_writes_issue(m_bringup_retry);
+    m_bringup_retry = 0;
+}
+
+
+/**@brief Function for noting the lamp's answer to the AUTH password.
+ */
+static void bringup_auth_done(void)
+{
+    // called from the main loop, the CCCD responses complete the bring-up from the SoftDevice observers
+    CRITICAL_REGION_ENTER();
+    if(m_bringup_state == BRINGUP_PENDING)
+     {
+      m_bringup_latency.auth_ms = bringup_elapsed_ms();
+      NRF_LOG_INFO("NAO+ answered AUTH after %d ms", m_bringup_latency.auth_ms);
+
+      m_bringup_done |= BRINGUP_AUTH_ANSWER;
+      bringup_ready_check();
+     }
+    CRITICAL_REGION_EXIT();
+}
+
+
+/**@brief Function for noting a telemetry frame, the first one after connecting is timed.
+ */
+static void bringup_telemetry(void)
+{
+    bool first;
+
+    // the bring-up state is driven from the SoftDevice observers
+    CRITICAL_REGION_ENTER();
+    first = (m_bringup_state != BRINGUP_IDLE) && (m_bringup_latency.telemetry_ms == 0);
+    if(first)
+     m_bringup_latency.telemetry_ms = bringup_elapsed_ms();
+    CRITICAL_REGION_EXIT();
+
+    if(!first)
+     return;
+
+    NRF_LOG_INFO("NAO+ connect to first telemetry: %d ms", m_bringup_latency.telemetry_ms);
+
+    if(!m_bringup_cached)
+     {
+      pm_peer_id_t peer_id;
+
+      // discovered handles just proved to work, keep them for the next connection of a bonded lamp
+      if((pm_peer_id_get(m_conn_handle_nao_c, &peer_id) == NRF_SUCCESS) && (peer_id != PM_PEER_ID_INVALID))
+       handle_cache_store(peer_id);
+     }
+}
+
+
+/**@brief Function for starting service discovery on a newly connected peer.
+ */
+static void discovery_start(uint16_t conn_handle)
+{
+    ret_code_t err_code;
+
+    err_code = ble_db_discovery_start(&m_db_discovery[0], conn_handle);
+
+    if (err_code == NRF_ERROR_BUSY)
+    {
+        err_code = ble_db_discovery_start(&m_db_discovery[1], conn_handle);
+        APP_ERROR_CHECK(err_code);
+    }
+    else
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for using the cached handles of a bonded lamp instead of service discovery.
+ *
+ * @return true if handles were found and assigned, the bring-up then starts right away.
+ */
+static bool handle_cache_assign(uint16_t conn_handle)
+{
+    ret_code_t     err_code;
+    pm_peer_id_t   peer_id;
+    handle_cache_t cache;
+
+    if((pm_peer_id_get(conn_handle, &peer_id) != NRF_SUCCESS) || (peer_id == PM_PEER_ID_INVALID))
+     return false;
+
+    if(!handle_cache_load(peer_id, &cache))
+     return false;
+
+    NRF_LOG_INFO("Using cached NAO+ handles of peer %d, skipping discovery", peer_id);
+
+    m_conn_handle_nao_c = conn_handle;
+
+    err_code = ble_nao_auth_c_handles_assign(&m_ble_nao_auth_c, conn_handle, &cache.auth);
+    APP_ERROR_CHECK(err_code);
+    err_code = ble_nao_stat_c_handles_assign(&m_ble_nao_stat_c, conn_handle, &cache.stat);
+    APP_ERROR_CHECK(err_code);
+    err_code = ble_nao_conf_c_handles_assign(&m_ble_nao_conf_c, conn_handle, &cache.conf);
+    APP_ERROR_CHECK(err_code);
+
+    m_bringup_cached = true;
+    bringup_service_found(BRINGUP_SRV_ALL);
+
+    return true;
+}
+
+
+/**@brief Function for checking a write response during a bring-up with cached handles.
+ *
+ * @details The CCCD writes are the first use of the cached handles. If the lamp rejects one
+ *          as an unknown handle, its layout changed: the record is dropped and discovery runs.
+ */
+static void handle_cache_validate(ble_gattc_evt_t const * p_gattc_evt)
+{
+    pm_peer_id_t peer_id;
+
+    if(!m_bringup_cached || (p_gattc_evt->conn_handle != m_conn_handle_nao_c))
+     return;
+
+    if((p_gattc_evt->gatt_status != BLE_GATT_STATUS_ATTERR_INVALID_HANDLE) &&
+       (p_gattc_evt->gatt_status != BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED))
+     return;
+
+    NRF_LOG_INFO("cached NAO+ handle 0x%x rejected (0x%x), falling back to discovery",
+                 p_gattc_evt->error_handle, p_gattc_evt->gatt_status);
+
+    if(pm_peer_id_get(p_gattc_evt->conn_handle, &peer_id) == NRF_SUCCESS)
+     handle_cache_delete(peer_id);
+
+    m_bringup_cached    = false;
+    m_bringup_srv_found = 0;
+    m_bringup_done      = 0;
+    m_bringup_retry     = 0;
+    m_bringup_unsent    = 0;
+
+    nao_gattc_dispatch_clear(p_gattc_evt->conn_handle);  // discovery registers the right handles
+    discovery_start(p_gattc_evt->conn_handle);
+}
+
+
+/**@brief Function for handling the write responses of the NAO+ CCCDs, routed by nao_gattc_dispatch().
+ */
+static void bringup_cccd_rsp(void * p_context, ble_evt_t const * p_ble_evt)
+{
+    handle_cache_validate(&p_ble_evt->evt.gattc_evt);
+    bringup_write_rsp(&p_ble_evt->evt.gattc_evt);
+}
+
+
+static void bringup_stop(void)
+{
+    m_bringup_state = BRINGUP_IDLE;
+
+    if(nao_conn_policy_bringup_set(false))
+     conn_params_apply();
+}
+
+
+/**@brief Function for keeping the NAO+ link up at a low duty cycle after the watch disconnected.
+ *
+ * @details The lamp keeps sending telemetry, which keeps the state cache live. Polling stops, there
+ *          is nobody to show the values to.
+ */
+static void linger_start(void)
+{
+    NRF_LOG_INFO("Watch gone, keeping NAO+ link for %d s", NAO_LINGER_MS / 1000);
+
+    m_linger_active   = true;
+    m_linger_start_ms = nao_cache_time_ms();
+    nao_poll_stop();
+
+    if(nao_conn_policy_linger_set(true))
+     conn_params_apply();
+}
+
+
+/**@brief Function for ending the linger period, because the watch returned or the lamp is gone.
+ */
+static void linger_end(void)
+{
+    if(!m_linger_active)
+     return;
+
+    m_linger_active = false;
+
+    if(m_bringup_state == BRINGUP_READY)
+     {
+      NRF_LOG_INFO("Watch back after %d ms, NAO+ link still up", nao_cache_time_ms() - m_linger_start_ms);
+      nao_poll_start(nao_cache_time_ms());
+     }
+
+    if(nao_conn_policy_linger_set(false))
+     conn_params_apply();
+}
+
+
+/**@brief Function for sending the cached lamp state to a watch which just enabled notifications.
+ */
+static void cache_replay(void)
+{
+    static const uint16_t replay_types[] = {0x2003, 0x7320, 0x7321, 0x7303};
+    nao_cache_entry_t const * p_entry;
+
+    for(uint8_t i = 0; i < ARRAY_SIZE(replay_types); i++)
+     {
+      CRITICAL_REGION_ENTER();
+      p_entry = nao_cache_get(replay_types[i]);
+      if(p_entry != NULL)
+       ble_nao_stat_notif_forward(&m_nao_proxy, (uint8_t *)p_entry->data, p_entry->len);
+      CRITICAL_REGION_EXIT();
+     }
+}
+
+
 static void create_timers()
 {
     ret_code_t err_code;
@@ -371,6 +1069,11 @@ static void create_timers()
                                 APP_TIMER_MODE_REPEATED,
                                 housekeeping_timer_handler);
     APP_ERROR_CHECK(err_code);
+
+    err_code = app_timer_create(&m_batch_timer_id,
+                                APP_TIMER_MODE_SINGLE_SHOT,
+                                batch_timer_handler);
+    APP_ERROR_CHECK(err_code);
 }
 
 void board_led_on(uint8_t led)
@@ -387,49 +1090,131 @@ void board_led_off(uint8_t led)
 
 // we are not forwarding AUTH messages to Garmin. Proxy does auth and encryption by itself.
 
+static void auth_rx_process(uint8_t const *data, uint16_t data_len)
+{
+    NRF_LOG_INFO("Received packet from NAO+ service 0x13 (AUTH), data len:%d\r\n",data_len);
+
+    if(data_len == 1)
+      {
+        NRF_LOG_INFO("Received packet from NAO+ service 0x13 (AUTH), data[0]:%X\r\n",data[0]);
+
+        if(data[0] == 0xA5)
+         {
+          NAO_pair_now = true;
+          NRF_LOG_INFO("NAO+ is waiting for pairing confirmation - press NAO+ knob briefly...\r\n");
+          bringup_auth_done();
+         }
+        else if(data[0] == 0xAA)
+         {
+          NRF_LOG_INFO("This NAO+ is already paired with this proxy...\r\n");
+          NAO_paired = true;
+          bringup_auth_done();
+         }
+      }
+}
+
+
+/**@brief Function for getting the message type a NAO+ request or reply is traced by, its first two bytes.
+ */
+static uint16_t lat_msg_type(uint8_t const *data, uint16_t data_len)
+{
+    if(data_len == 0)
+     return 0;
+
+    return (data[0] << 8) | ((data_len > 1) ? data[1] : 0);
+}
+
+
+static void stat_rx_process(uint8_t const *data, uint16_t data_len)
+{
+    uint32_t err_code;
+    bool pass;
+
+    NRF_LOG_DEBUG("Received packet from NAO+ service 0x68 (STAT), data len:%d\r\n",data_len);
+    NRF_LOG_DEBUG("bytes 0-5: %02x,%02x,%02x,%02x,%02x,%02x\r\n",data[0],data[1],data[2],data[3],data[4],data[5]);
+    if((data_len >= 2) && (data[0] == 0x20) && (data[1] == 0x03))
+     bringup_telemetry();
+    // cache and filter are also cleared and aged by the observers and the housekeeping timer
+    CRITICAL_REGION_ENTER();
+    nao_cache_update(data, data_len);
+    pass = nao_filter_pass(data, data_len, nao_cache_time_ms());
+    CRITICAL_REGION_EXIT();
+    if(!pass)
+     {
+      nao_stats_srv_evt(NAO_STATS_SRV_STAT, NAO_STATS_EVT_FILTERED);
+      return; // unchanged telemetry, the watch is kept up to date by the heartbeat
+     }
+    err_code = ble_nao_stat_notif_forward(&m_nao_proxy, (uint8_t *)data, data_len);
+    NRF_LOG_DEBUG("forward notification returned: %d",err_code);
+    if(err_code == NRF_SUCCESS)
+     {
+      nao_stats_srv_evt(NAO_STATS_SRV_STAT, NAO_STATS_EVT_FORWARDED);
+      nao_lat_watch_tx(0x68, lat_msg_type(data, data_len));
+     }
+    else
+     nao_stats_srv_evt(NAO_STATS_SRV_STAT, NAO_STATS_EVT_DROPPED);
+}
+
+
+static void conf_rx_process(uint8_t const *data, uint16_t data_len)
+{
+    uint32_t err_code;
+    bool poll_only;
+    bool changed;
+
+    NRF_LOG_DEBUG("Received packet from NAO+ service 0x09 (CONF), data len:%d\r\n",data_len);
+    NRF_LOG_DEBUG("bytes 0-5: %02x,%02x,%02x,%02x,%02x,%02x\r\n",data[0],data[1],data[2],data[3],data[4],data[5]);
+    CRITICAL_REGION_ENTER();
+    poll_only = (data_len >= 2) && nao_poll_reply_received((data[0] << 8) | data[1]);
+    changed = nao_cache_update(data, data_len);
+    CRITICAL_REGION_EXIT();
+    if(poll_only && !changed)
+     {
+      // answer to a proxy poll, the watch already has this value
+      NRF_LOG_DEBUG("polled value unchanged, not forwarded");
+      nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_FILTERED);
+      return;
+     }
+    err_code = ble_nao_stat_notif_forward(&m_nao_proxy, (uint8_t *)data, data_len);
+    NRF_LOG_DEBUG("forward notification returned: %d",err_code);
+    if(err_code == NRF_SUCCESS)
+     {
+      nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_FORWARDED);
+      nao_lat_watch_tx(0x09, lat_msg_type(data, data_len));
+     }
+    else
+     nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_DROPPED);
+}
+
+
 static void ble_nao_auth_c_evt_handler(ble_nao_auth_c_t * p_ble_nao_auth_c, const ble_nao_auth_c_evt_t * p_ble_nao_auth_evt)
 {
     uint32_t err_code;
 
 
-    NRF_LOG_INFO("ble_nao_auth_c_evt_handler: event: %X\r\n",p_ble_nao_auth_evt->evt_type);
+    NRF_LOG_DEBUG("ble_nao_auth_c_evt_handler: event: %X\r\n",p_ble_nao_auth_evt->evt_type);
 
     switch (p_ble_nao_auth_evt->evt_type)
     {
         case BLE_NAO_AUTH_C_EVT_DISCOVERY_COMPLETE:
 
-            nrf_delay_ms(1000);
-
             m_conn_handle_nao_c = p_ble_nao_auth_evt->conn_handle;
 
             err_code = ble_nao_auth_c_handles_assign(p_ble_nao_auth_c, p_ble_nao_auth_evt->conn_handle, &p_ble_nao_auth_evt->handles);
             APP_ERROR_CHECK(err_code);
-            err_code = ble_nao_auth_c_rx_notif_enable(p_ble_nao_auth_c);
-            APP_ERROR_CHECK(err_code);
             NRF_LOG_INFO("The device has the NAO+ service 0x13 (AUTH)\r\n");  
-            nrf_delay_ms(1000);
+            bringup_service_found(BRINGUP_SRV_AUTH);
             break;
         
         case BLE_NAO_AUTH_C_EVT_NAO_AUTH_RX_EVT:
-            NRF_LOG_INFO("Received packet from NAO+ service 0x13 (AUTH), data len:%d\r\n",p_ble_nao_auth_evt->data_len);
-             
-            if(p_ble_nao_auth_evt->data_len == 1)
-              {
-                uint8_t *data = p_ble_nao_auth_evt->p_data;
-
-                NRF_LOG_INFO("Received packet from NAO+ service 0x13 (AUTH), data[0]:%X\r\n",data[0]);
-
-                if(data[0] == 0xA5)
-                 {
-                  NAO_pair_now = true;
-                  NRF_LOG_INFO("NAO+ is waiting for pairing confirmation - press NAO+ knob briefly...\r\n");
-                 }
-                else if(data[0] == 0xAA)
-                 {
-                  NRF_LOG_INFO("This NAO+ is already paired with this proxy...\r\n");
-                  NAO_paired = true;
-                 }
-              }
+            // handled in the main loop by auth_rx_process()
+            nao_stats_srv_evt(NAO_STATS_SRV_AUTH, NAO_STATS_EVT_RX);
+            err_code = nao_pipe_put(NAO_PIPE_PRIO_HIGH, NAO_PIPE_SRC_AUTH, p_ble_nao_auth_evt->p_data, p_ble_nao_auth_evt->data_len);
+            if(err_code != NRF_SUCCESS)
+             {
+              NRF_LOG_INFO("AUTH packet dropped: %d", err_code);
+              nao_stats_srv_evt(NAO_STATS_SRV_AUTH, NAO_STATS_EVT_DROPPED);
+             }
             break;
         
         case BLE_NAO_AUTH_C_EVT_DISCONNECTED:
@@ -444,9 +1229,8 @@ static void ble_nao_stat_c_evt_handler(ble_nao_stat_c_t * p_ble_nao_stat_c, cons
 {
    
     uint32_t err_code;
-    uint8_t *data;
 
-    NRF_LOG_INFO("ble_nao_stat_c_evt_handler: event: %X\r\n",p_ble_nao_stat_evt->evt_type);
+    NRF_LOG_DEBUG("ble_nao_stat_c_evt_handler: event: %X\r\n",p_ble_nao_stat_evt->evt_type);
 
     switch (p_ble_nao_stat_evt->evt_type)
     {
@@ -454,23 +1238,19 @@ static void ble_nao_stat_c_evt_handler(ble_nao_stat_c_t * p_ble_nao_stat_c, cons
             err_code = ble_nao_stat_c_handles_assign(p_ble_nao_stat_c, p_ble_nao_stat_evt->conn_handle, &p_ble_nao_stat_evt->handles);
             APP_ERROR_CHECK(err_code);
 
-            err_code = ble_nao_stat_c_rx_notif_enable(p_ble_nao_stat_c);
-            APP_ERROR_CHECK(err_code);
-
             NRF_LOG_INFO("The device has the NAO+ service 0x68 (STAT)\r\n");
-            NRF_LOG_INFO("Sending AUTH password to service 0x13\r\n");
-            err_code = ble_nao_auth_c_send_auth(&m_ble_nao_auth_c);
-            APP_ERROR_CHECK(err_code);
-           
-
+            bringup_service_found(BRINGUP_SRV_STAT);
             break;
 
         case BLE_NAO_STAT_C_EVT_NAO_STAT_RX_EVT:
-            data = p_ble_nao_stat_evt->p_data;
-            NRF_LOG_INFO("Received packet from NAO+ service 0x68 (STAT), data len:%d\r\n",p_ble_nao_stat_evt->data_len);
-            NRF_LOG_INFO("bytes 0-5: %02x,%02x,%02x,%02x\r\n",data[0],data[1],data[2],data[3],data[4],data[5]);
-            err_code = ble_nao_stat_notif_forward(&m_nao_proxy, data, p_ble_nao_stat_evt->data_len);
-            NRF_LOG_INFO("forward notification returned: %d",err_code);
+            // handled in the main loop by stat_rx_process()
+            nao_stats_srv_evt(NAO_STATS_SRV_STAT, NAO_STATS_EVT_RX);
+            err_code = nao_pipe_put(NAO_PIPE_PRIO_LOW, NAO_PIPE_SRC_STAT, p_ble_nao_stat_evt->p_data, p_ble_nao_stat_evt->data_len);
+            if(err_code != NRF_SUCCESS)
+             {
+              NRF_LOG_INFO("STAT packet dropped: %d", err_code);
+              nao_stats_srv_evt(NAO_STATS_SRV_STAT, NAO_STATS_EVT_DROPPED);
+             }
             break;
 
         case BLE_NAO_STAT_C_EVT_DISCONNECTED:
@@ -485,9 +1265,8 @@ static void ble_nao_conf_c_evt_handler(ble_nao_conf_c_t * p_ble_nao_conf_c, cons
 {
 
     uint32_t err_code;
-    uint8_t *data;
 
-    NRF_LOG_INFO("ble_nao_conf_c_evt_handler: event: %X\r\n",p_ble_nao_conf_evt->evt_type);
+    NRF_LOG_DEBUG("ble_nao_conf_c_evt_handler: event: %X\r\n",p_ble_nao_conf_evt->evt_type);
 
     switch (p_ble_nao_conf_evt->evt_type)
     {
@@ -495,20 +1274,21 @@ static void ble_nao_conf_c_evt_handler(ble_nao_conf_c_t * p_ble_nao_conf_c, cons
             err_code = ble_nao_conf_c_handles_assign(p_ble_nao_conf_c, p_ble_nao_conf_evt->conn_handle, &p_ble_nao_conf_evt->handles);
             APP_ERROR_CHECK(err_code);
 
-            err_code = ble_nao_conf_c_rx_notif_enable(p_ble_nao_conf_c);
-            APP_ERROR_CHECK(err_code);
-
             NRF_LOG_INFO("The device has the NAO+ service 0x09 (CONF)\r\n");
+            bringup_service_found(BRINGUP_SRV_CONF);
 
 
             break;
 
         case BLE_NAO_CONF_C_EVT_NAO_CONF_RX_EVT:
-            data = p_ble_nao_conf_evt->p_data;
-            NRF_LOG_INFO("Received packet from NAO+ service 0x09 (CONF), data len:%d\r\n",p_ble_nao_conf_evt->data_len);
-            NRF_LOG_INFO("bytes 0-5: %02x,%02x,%02x,%02x\r\n",data[0],data[1],data[2],data[3],data[4],data[5]);
-            err_code = ble_nao_stat_notif_forward(&m_nao_proxy, data, p_ble_nao_conf_evt->data_len);
-            NRF_LOG_INFO("forward notification returned: %d",err_code);
+            // handled in the main loop by conf_rx_process(), answers to the watch go before telemetry
+            nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_RX);
+            err_code = nao_pipe_put(NAO_PIPE_PRIO_HIGH, NAO_PIPE_SRC_CONF, p_ble_nao_conf_evt->p_data, p_ble_nao_conf_evt->data_len);
+            if(err_code != NRF_SUCCESS)
+             {
+              NRF_LOG_INFO("CONF packet dropped: %d", err_code);
+              nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_DROPPED);
+             }
             break;
 
         case BLE_NAO_CONF_C_EVT_DISCONNECTED:
@@ -613,6 +1393,16 @@ static void scan_evt_handler(scan_evt_t const * p_scan_evt)
             APP_ERROR_CHECK(err_code);
         } break;
 
+        case NRF_BLE_SCAN_EVT_WHITELIST_ADV_REPORT:
+        {
+            // Only bonded lamps pass the whitelist, connect on the first report.
+            err_code = sd_ble_gap_connect(&p_scan_evt->params.p_whitelist_adv_report->peer_addr,
+                                          p_scan_param,
+                                          &m_scan.conn_params,
+                                          APP_BLE_CONN_CFG_TAG);
+            APP_ERROR_CHECK(err_code);
+        } break;
+
         default:
             break;
     }
@@ -654,20 +1444,219 @@ static void scan_init(void)
 }
 
 
+/**@brief Function for setting the device identity list from all bonds, lamps and watch alike.
+ *
+ * @details Lets the SoftDevice resolve private addresses for the whitelist and for directed
+ *          advertising. The list cannot change while a role uses it, so this is called before
+ *          scanning or advertising starts and is retried there until it succeeds.
+ */
+static void peer_identities_update(void)
+{
+    ret_code_t   err_code;
+    pm_peer_id_t peers[BLE_GAP_DEVICE_IDENTITIES_MAX_COUNT];
+    uint32_t     peer_cnt = 0;
+
+    if (!m_identities_pending)
+    {
+        return;
+    }
+
+    for (pm_peer_id_t peer_id = pm_next_peer_id_get(PM_PEER_ID_INVALID);
+         (peer_id != PM_PEER_ID_INVALID) && (peer_cnt < BLE_GAP_DEVICE_IDENTITIES_MAX_COUNT);
+         peer_id = pm_next_peer_id_get(peer_id))
+    {
+        peers[peer_cnt++] = peer_id;
+    }
+
+    err_code = pm_device_identities_list_set((peer_cnt > 0) ? peers : NULL, peer_cnt);
+    if (err_code == NRF_ERROR_INVALID_STATE)
+    {
+        NRF_LOG_INFO("Identity list in use, set later");
+        return;
+    }
+    if (err_code != NRF_ERROR_NOT_SUPPORTED)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    m_identities_pending = false;
+}
+
+
+/**@brief Function for checking whether a bond belongs to a lamp.
+ *
+ * @details The proxy is central only to the lamp, so the role saved with the bond tells a lamp
+ *          from the watch even before the lamp's NAO+ handles have been cached.
+ */
+static bool peer_is_lamp(pm_peer_id_t peer_id)
+{
+    pm_peer_data_bonding_t bonding;
+
+    return (pm_peer_data_bonding_load(peer_id, &bonding) == NRF_SUCCESS) &&
+           (bonding.own_role == BLE_GAP_ROLE_CENTRAL);
+}
+
+
+/**@brief Function for putting the bonded lamps on the whitelist.
+ *
+ * @details A bonded watch is never added.
+ *
+ * @return Number of lamps on the whitelist, 0 if the whitelist could not be set.
+ */
+static uint32_t lamp_whitelist_load(void)
+{
+    ret_code_t     err_code;
+    pm_peer_id_t   peers[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+    uint32_t       peer_cnt = 0;
+
+    for (pm_peer_id_t peer_id = pm_next_peer_id_get(PM_PEER_ID_INVALID);
+         (peer_id != PM_PEER_ID_INVALID) && (peer_cnt < BLE_GAP_WHITELIST_ADDR_MAX_COUNT);
+         peer_id = pm_next_peer_id_get(peer_id))
+    {
+        if (peer_is_lamp(peer_id))
+        {
+            peers[peer_cnt++] = peer_id;
+        }
+    }
+
+    err_code = pm_whitelist_set((peer_cnt > 0) ? peers : NULL, peer_cnt);
+    if (err_code == NRF_ERROR_INVALID_STATE)
+    {
+        // The whitelist is still in use, the name and UUID filters find the lamp as well.
+        NRF_LOG_WARNING("Whitelist busy, scanning with filters");
+        return 0;
+    }
+    APP_ERROR_CHECK(err_code);
+
+    return peer_cnt;
+}
+
+
 /**@brief Function for initializing the scanning.
+ *
+ * @details With a bonded lamp the burst stage uses the whitelist and connects on its first
+ *          advertising report. If no bonded lamp shows up during the burst, the later stages
+ *          go back to the name and UUID filters, which also find a new or re-flashed lamp.
  */
 static void scan_start(void)
 {
     ret_code_t err_code;
 
-    err_code = nrf_ble_scan_start(&m_scan);
+    // The whitelist cannot change while a scan is using it.
+    nrf_ble_scan_stop();
+    peer_identities_update();
+
+    if ((nao_scan_policy_stage_get() == NAO_SCAN_STAGE_BURST) && (lamp_whitelist_load() > 0))
+    {
+        NRF_LOG_INFO("Scanning for bonded NAO+ (whitelist)");
+        m_scan_param.filter_policy = BLE_GAP_SCAN_FP_WHITELIST;
+    }
+    else
+    {
+        NRF_LOG_INFO("Scanning for NAO+ by name: %s", m_target_periph_name);
+        m_scan_param.filter_policy = BLE_GAP_SCAN_FP_ACCEPT_ALL;
+    }
+
+    nao_scan_policy_params_apply(&m_scan_param);
+
+    err_code = nrf_ble_scan_params_set(&m_scan, &m_scan_param);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrf_ble_scan_start(&m_scan);
+    APP_ERROR_CHECK(err_code);
+
+    m_scan_active = true;
+}
+
+
+static void scan_stop(void)
+{
+    nrf_ble_scan_stop();
+    m_scan_active = false;
+}
+
+
+/**@brief Function for checking that an address stays the same across connections. */
+static bool addr_is_identity(ble_gap_addr_t const * p_addr)
+{
+    return (p_addr->addr_type == BLE_GAP_ADDR_TYPE_PUBLIC) ||
+           (p_addr->addr_type == BLE_GAP_ADDR_TYPE_RANDOM_STATIC);
+}
+
+
+/**@brief Function for remembering the address of a connected watch for directed advertising.
+ *
+ * @details A bonded watch is known by its identity address. Otherwise the connection address is
+ *          used, unless it is a private one which the watch will not use again.
+ */
+static void watch_addr_store(uint16_t conn_handle, ble_gap_addr_t const * p_peer_addr)
+{
+    pm_peer_id_t           peer_id;
+    pm_peer_data_bonding_t bonding;
+
+    if((pm_peer_id_get(conn_handle, &peer_id) == NRF_SUCCESS) && (peer_id != PM_PEER_ID_INVALID) &&
+       (pm_peer_data_bonding_load(peer_id, &bonding) == NRF_SUCCESS) &&
+       addr_is_identity(&bonding.peer_ble_id.id_addr_info))
+     {
+      m_watch_addr       = bonding.peer_ble_id.id_addr_info;
+      m_watch_addr_valid = true;
+     }
+    else if(addr_is_identity(p_peer_addr))
+     {
+      m_watch_addr       = *p_peer_addr;
+      m_watch_addr_valid = true;
+     }
+}
+
+
+/**@brief Function for finding a bonded watch after a reset, the proxy is peripheral only to a watch.
+ */
+static void watch_addr_load(void)
+{
+    pm_peer_data_bonding_t bonding;
+
+    for(pm_peer_id_t peer_id = pm_next_peer_id_get(PM_PEER_ID_INVALID);
+        peer_id != PM_PEER_ID_INVALID;
+        peer_id = pm_next_peer_id_get(peer_id))
+     {
+      if((pm_peer_data_bonding_load(peer_id, &bonding) == NRF_SUCCESS) &&
+         (bonding.own_role == BLE_GAP_ROLE_PERIPH) &&
+         addr_is_identity(&bonding.peer_ble_id.id_addr_info))
+       {
+        m_watch_addr       = bonding.peer_ble_id.id_addr_info;
+        m_watch_addr_valid = true;
+       }
+     }
+}
+
+
+/**@brief Function for advertising with the parameters of the current advertising stage.
+ */
+static void advertising_start(void)
+{
+    ret_code_t           err_code;
+    ble_gap_adv_params_t adv_params;
+
+    memset(&adv_params, 0, sizeof(adv_params));
+
+    adv_params.primary_phy   = BLE_GAP_PHY_1MBPS;  // legacy advertising, links move to 2M after connecting
+    adv_params.filter_policy = BLE_GAP_ADV_FP_ANY;
+    nao_adv_policy_params_apply(&adv_params);
+
+    if(nao_adv_policy_stage_get() == NAO_ADV_STAGE_DIRECTED)
+     {
+      // directed advertising carries no advertising data
+      adv_params.p_peer_addr = &m_watch_addr;
+      err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, NULL, &adv_params);
+     }
+    else
+     err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &m_adv_data, &adv_params);
     APP_ERROR_CHECK(err_code);
-}
 
+    peer_identities_update();
 
-static void scan_stop(void)
-{
-    nrf_ble_scan_stop();
+    err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -675,8 +1664,6 @@ static void scan_stop(void)
  */
 static void adv_scan_start(void)
 {
-    ret_code_t err_code;
-
     //check if there are no flash operations in progress
     if (!nrf_fstorage_is_busy(NULL))
     {
@@ -687,8 +1674,8 @@ static void adv_scan_start(void)
         // Turn on the LED to signal scanning.
 
         // Start advertising.
-        err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
-        APP_ERROR_CHECK(err_code);
+        nao_adv_policy_restart(m_watch_addr_valid);
+        advertising_start();
         //err_code = ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
         //APP_ERROR_CHECK(err_code);
     }
@@ -707,7 +1694,22 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
 
     switch (p_evt->evt_id)
     {
+        case PM_EVT_CONN_SEC_SUCCEEDED:
+            if (p_evt->params.conn_sec_succeeded.procedure == PM_CONN_SEC_PROCEDURE_BONDING)
+            {
+                m_identities_pending = true;
+            }
+            bringup_conn_secured(p_evt->conn_handle);
+            break;
+
+        case PM_EVT_PEER_DELETE_SUCCEEDED:
+            handle_cache_delete(p_evt->peer_id);
+            m_identities_pending = true;
+            break;
+
         case PM_EVT_PEERS_DELETE_SUCCEEDED:
+            m_identities_pending = true;
+            (void)fds_file_delete(HANDLE_CACHE_FILE_ID);  // cached NAO+ handles belong to the deleted bonds
             adv_scan_start();
             break;
 
@@ -779,9 +1781,19 @@ static void on_ble_central_evt(ble_evt_t const * p_ble_evt)
 
     // NRF_LOG_INFO("Central event: %X",p_ble_evt->header.evt_id);
 
-    ble_nao_auth_c_on_ble_evt(&m_ble_nao_auth_c,p_ble_evt);
-    ble_nao_stat_c_on_ble_evt(&m_ble_nao_stat_c,p_ble_evt);
-    ble_nao_conf_c_on_ble_evt(&m_ble_nao_conf_c,p_ble_evt);
+    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        ble_nao_auth_c_on_ble_evt(&m_ble_nao_auth_c,p_ble_evt);
+        ble_nao_stat_c_on_ble_evt(&m_ble_nao_stat_c,p_ble_evt);
+        ble_nao_conf_c_on_ble_evt(&m_ble_nao_conf_c,p_ble_evt);
+    }
+    nao_generic_on_ble_evt(p_ble_evt);  // drain NAO+ TX queue on write response / TX complete
+
+    // Notifications and write responses go to the one consumer registered for their handle.
+    if (nao_gattc_dispatch(p_ble_evt))
+    {
+        return;
+    }
 
     switch (p_ble_evt->header.evt_id)
     {
@@ -790,6 +1802,13 @@ static void on_ble_central_evt(ble_evt_t const * p_ble_evt)
         case BLE_GAP_EVT_CONNECTED:
         {
             NRF_LOG_INFO("Central connected");
+            m_scan_active = false;  // the SoftDevice stops scanning when it connects
+            nao_stats_link_connected(NAO_CONN_LINK_LAMP, nao_cache_time_ms());
+            nao_conn_policy_link_update(NAO_CONN_LINK_LAMP, &p_gap_evt->params.connected.conn_params);
+            phy_request(NAO_CONN_LINK_LAMP, p_gap_evt->conn_handle, nao_phy_connected(NAO_CONN_LINK_LAMP, nao_cache_time_ms()));
+
+            err_code = sd_ble_gap_rssi_start(p_gap_evt->conn_handle, NAO_PHY_RSSI_THRESHOLD_DB, NAO_PHY_RSSI_SKIP_COUNT);
+            APP_ERROR_CHECK(err_code);
 
             err_code = pm_conn_secure(p_gap_evt->conn_handle, false);
             APP_ERROR_CHECK(err_code);
@@ -800,17 +1819,11 @@ static void on_ble_central_evt(ble_evt_t const * p_ble_evt)
             if (m_conn_handle_nao_c  == BLE_CONN_HANDLE_INVALID)
             {
                 NRF_LOG_INFO("Attempt to find NAO+ on conn_handle 0x%x", p_gap_evt->conn_handle);
-                
-                err_code = ble_db_discovery_start(&m_db_discovery[0], p_gap_evt->conn_handle);
+                bringup_start();
 
-                if (err_code == NRF_ERROR_BUSY)
+                if (!handle_cache_assign(p_gap_evt->conn_handle))
                 {
-                    err_code = ble_db_discovery_start(&m_db_discovery[1], p_gap_evt->conn_handle);
-                    APP_ERROR_CHECK(err_code);
-                }
-                else
-                {
-                    APP_ERROR_CHECK(err_code);
+                    discovery_start(p_gap_evt->conn_handle);
                 }
             }
 
@@ -839,6 +1852,21 @@ static void on_ble_central_evt(ble_evt_t const * p_ble_evt)
                              p_gap_evt->params.disconnected.reason);
 
                 m_conn_handle_nao_c = BLE_CONN_HANDLE_INVALID;
+                nao_stats_link_disconnected(NAO_CONN_LINK_LAMP, p_gap_evt->params.disconnected.reason, nao_cache_time_ms());
+                nao_conn_policy_link_reset(NAO_CONN_LINK_LAMP);
+                nao_phy_disconnected(NAO_CONN_LINK_LAMP, nao_cache_time_ms());
+                nao_cache_clear();
+                nao_poll_stop();
+                nao_filter_reset();
+                bringup_stop();
+                linger_end();
+
+                if (m_nao_proxy.conn_handle != BLE_CONN_HANDLE_INVALID)
+                {
+                    // lamp lost while the watch is connected, look for it at full speed
+                    nao_scan_policy_burst(nao_cache_time_ms());
+                    scan_start();
+                }
                 
                 err_code = nrf_ble_scan_filter_set(&m_scan, 
                                                    SCAN_UUID_FILTER, 
@@ -871,12 +1899,36 @@ static void on_ble_central_evt(ble_evt_t const * p_ble_evt)
 
         case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
         {
-            // Accept parameters requested by peer.
-            err_code = sd_ble_gap_conn_param_update(p_gap_evt->conn_handle,
-                                        &p_gap_evt->params.conn_param_update_request.conn_params);
+            // Accept what the lamp asks for, as far as the current connection profile allows.
+            ble_gap_conn_params_t conn_params = p_gap_evt->params.conn_param_update_request.conn_params;
+
+            nao_conn_policy_peer_request(&conn_params);
+            err_code = sd_ble_gap_conn_param_update(p_gap_evt->conn_handle, &conn_params);
             APP_ERROR_CHECK(err_code);
         } break;
 
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            nao_conn_policy_link_update(NAO_CONN_LINK_LAMP, &p_gap_evt->params.conn_param_update.conn_params);
+            break;
+
+        case BLE_GAP_EVT_RSSI_CHANGED:
+        {
+            uint8_t phy = nao_phy_rssi_update(NAO_CONN_LINK_LAMP, p_gap_evt->params.rssi_changed.rssi);
+
+            if (phy != BLE_GAP_PHY_AUTO)
+            {
+                phy_request(NAO_CONN_LINK_LAMP, p_gap_evt->conn_handle, phy);
+            }
+        } break;
+
+        case BLE_GAP_EVT_PHY_UPDATE:
+            nao_phy_updated(NAO_CONN_LINK_LAMP,
+                            p_gap_evt->params.phy_update.status,
+                            p_gap_evt->params.phy_update.tx_phy,
+                            p_gap_evt->params.phy_update.rx_phy,
+                            nao_cache_time_ms());
+            break;
+
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
         {
             NRF_LOG_DEBUG("PHY update request.");
@@ -940,10 +1992,22 @@ static void on_ble_peripheral_evt(ble_evt_t const * p_ble_evt)
     {
         case BLE_GAP_EVT_CONNECTED:
 
-            if(m_conn_handle_nao_c == BLE_CONN_HANDLE_INVALID)
+            if((m_conn_handle_nao_c == BLE_CONN_HANDLE_INVALID) && m_deferred_init_done)
+             {
+              nao_scan_policy_burst(nao_cache_time_ms()); // watch is waiting for the lamp
               scan_start();
+             }
 
             NRF_LOG_INFO("Peripheral connected");
+            nao_stats_link_connected(NAO_CONN_LINK_WATCH, nao_cache_time_ms());
+            watch_addr_store(p_gap_evt->conn_handle, &p_gap_evt->params.connected.peer_addr);
+            nao_filter_reset(); // first telemetry frame goes straight to the new watch
+            linger_end();
+            nao_conn_policy_link_update(NAO_CONN_LINK_WATCH, &p_gap_evt->params.connected.conn_params);
+            phy_request(NAO_CONN_LINK_WATCH, p_gap_evt->conn_handle, nao_phy_connected(NAO_CONN_LINK_WATCH, nao_cache_time_ms()));
+
+            if(nao_conn_policy_profile_get() != NAO_CONN_PROFILE_IDLE)
+             conn_params_apply(); // the watch link starts from the idle PPCP
             board_led_on(PERIPHERAL_CONNECTED_LED);
 
             // Assign connection handle to the QWR module.
@@ -956,25 +2020,57 @@ static void on_ble_peripheral_evt(ble_evt_t const * p_ble_evt)
                          p_gap_evt->params.disconnected.reason);
 
             board_led_off(PERIPHERAL_CONNECTED_LED);
+            nao_stats_link_disconnected(NAO_CONN_LINK_WATCH, p_gap_evt->params.disconnected.reason, nao_cache_time_ms());
+            nao_conn_policy_link_reset(NAO_CONN_LINK_WATCH);
+            nao_phy_disconnected(NAO_CONN_LINK_WATCH, nao_cache_time_ms());
+            nao_conn_policy_menu_set(false, nao_cache_time_ms());
  
             if(m_conn_handle_nao_c != BLE_CONN_HANDLE_INVALID)
              {
-               err_code = sd_ble_gap_disconnect(m_conn_handle_nao_c,BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+               if(NAO_LINGER_MS > 0)
+                linger_start(); // a returning watch finds the lamp connected and the cache live
+               else
+                {
+                 err_code = sd_ble_gap_disconnect(m_conn_handle_nao_c,BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+                 APP_ERROR_CHECK(err_code);
+                }
                scan_stop();
-               APP_ERROR_CHECK(err_code);
              }
             else
               scan_stop();
 
-            err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
-            APP_ERROR_CHECK(err_code);
+            nao_adv_policy_restart(m_watch_addr_valid); // the watch usually comes back soon
+            advertising_start();
 
             break;
 
-        case 38:
-            NRF_LOG_INFO("Central advertising timeout. Restart.");
-            err_code = sd_ble_gap_adv_start(m_adv_handle, APP_BLE_CONN_CFG_TAG);
-            APP_ERROR_CHECK(err_code);
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            nao_conn_policy_link_update(NAO_CONN_LINK_WATCH, &p_gap_evt->params.conn_param_update.conn_params);
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+            if((p_ble_evt->evt.gatts_evt.params.write.handle == m_nao_proxy.nao_notif_char_handles.cccd_handle) &&
+               ble_srv_is_notification_enabled(p_ble_evt->evt.gatts_evt.params.write.data))
+             {
+              // lamp state known from before the watch connected goes out right away, see cache_replay()
+              err_code = nao_pipe_put(NAO_PIPE_PRIO_HIGH, NAO_PIPE_SRC_REPLAY, NULL, 0);
+              if(err_code != NRF_SUCCESS)
+               NRF_LOG_INFO("cache replay dropped: %d", err_code);
+             }
+            break;
+
+        case BLE_GAP_EVT_PHY_UPDATE:
+            nao_phy_updated(NAO_CONN_LINK_WATCH,
+                            p_gap_evt->params.phy_update.status,
+                            p_gap_evt->params.phy_update.tx_phy,
+                            p_gap_evt->params.phy_update.rx_phy,
+                            nao_cache_time_ms());
+            break;
+
+        case BLE_GAP_EVT_ADV_SET_TERMINATED:
+            NRF_LOG_INFO("Advertising stage %d timed out.", nao_adv_policy_stage_get());
+            if(nao_adv_policy_next())
+             advertising_start();
 
             break;
 
@@ -1026,11 +2122,15 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
     // Based on the role this device plays in the connection, dispatch to the right handler.
     if (role == BLE_GAP_ROLE_PERIPH || ble_evt_is_advertising_timeout(p_ble_evt))
     {
+     NAO_CYC_START(NAO_CYC_PERIPHERAL_EVT);
      on_ble_peripheral_evt(p_ble_evt);
+     NAO_CYC_STOP(NAO_CYC_PERIPHERAL_EVT);
     }
     else if ((role == BLE_GAP_ROLE_CENTRAL) || (p_ble_evt->header.evt_id == BLE_GAP_EVT_ADV_REPORT))
     {
+     NAO_CYC_START(NAO_CYC_CENTRAL_EVT);
      on_ble_central_evt(p_ble_evt);
+     NAO_CYC_STOP(NAO_CYC_CENTRAL_EVT);
     }
 }
 
@@ -1146,23 +2246,52 @@ static void gap_params_init(void)
                                           strlen(DEVICE_NAME));
     APP_ERROR_CHECK(err_code);
 
-    memset(&gap_conn_params, 0, sizeof(gap_conn_params));
-
-    gap_conn_params.min_conn_interval = m_scan.conn_params.min_conn_interval;
-    gap_conn_params.max_conn_interval = m_scan.conn_params.max_conn_interval;
-    gap_conn_params.slave_latency     = m_scan.conn_params.slave_latency;
-    gap_conn_params.conn_sup_timeout  = m_scan.conn_params.conn_sup_timeout;
+    // the watch link mostly carries periodic telemetry, the policy asks for more when needed
+    nao_conn_policy_params_get(NAO_CONN_PROFILE_IDLE, &gap_conn_params);
 
     err_code = sd_ble_gap_ppcp_set(&gap_conn_params);
     APP_ERROR_CHECK(err_code);
 }
 
 
+/**@brief Function for handling events from the GATT module.
+ */
+static void gatt_evt_handler(nrf_ble_gatt_t * p_gatt, nrf_ble_gatt_evt_t const * p_evt)
+{
+    switch (p_evt->evt_id)
+    {
+        case NRF_BLE_GATT_EVT_ATT_MTU_UPDATED:
+            NRF_LOG_INFO("ATT MTU on conn_handle 0x%x: %d", p_evt->conn_handle, p_evt->params.att_mtu_effective);
+            if (p_evt->conn_handle == m_nao_proxy.conn_handle)
+            {
+                nao_proxy_att_mtu_set(&m_nao_proxy, p_evt->params.att_mtu_effective);
+            }
+            break;
+
+        case NRF_BLE_GATT_EVT_DATA_LENGTH_UPDATED:
+            NRF_LOG_INFO("Data length on conn_handle 0x%x: %d", p_evt->conn_handle, p_evt->params.data_length);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
 /**@brief Function for initializing the GATT module.
+ *
+ * @details The watch link may negotiate up to NRF_SDH_BLE_GATT_MAX_MTU_SIZE, the NAO+ protocol
+ *          never sends more than 20 bytes so the lamp link stays at the default MTU.
  */
 static void gatt_init(void)
 {
-    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, NULL);
+    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, gatt_evt_handler);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrf_ble_gatt_att_mtu_periph_set(&m_gatt, NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = nrf_ble_gatt_att_mtu_central_set(&m_gatt, BLE_GATT_ATT_MTU_DEFAULT);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -1181,7 +2310,7 @@ static void conn_params_init(void)
     cp_init.next_conn_params_update_delay  = NEXT_CONN_PARAMS_UPDATE_DELAY;
     cp_init.max_conn_params_update_count   = MAX_CONN_PARAMS_UPDATE_COUNT;
     cp_init.start_on_notify_cccd_handle    = BLE_CONN_HANDLE_INVALID; // Start upon connection.
-    cp_init.disconnect_on_fail             = true;
+    cp_init.disconnect_on_fail             = false;  // the watch may keep its own parameters
     cp_init.evt_handler                    = NULL;  // Ignore events.
     cp_init.error_handler                  = conn_params_error_handler;
 
@@ -1203,9 +2332,27 @@ static void db_disc_handler(ble_db_discovery_evt_t * p_evt)
 
     ble_db_discovery_t const * p_db = (ble_db_discovery_t *)p_evt->params.p_db_instance;
 
-    ble_nao_auth_c_on_db_disc_evt(&m_ble_nao_auth_c, p_evt);
-    ble_nao_stat_c_on_db_disc_evt(&m_ble_nao_stat_c, p_evt);
-    ble_nao_conf_c_on_db_disc_evt(&m_ble_nao_conf_c, p_evt);
+    // Only the client of the discovered service sees the event.
+    if (p_evt->evt_type == BLE_DB_DISCOVERY_COMPLETE)
+    {
+        switch (p_evt->params.discovered_db.srv_uuid.uuid)
+        {
+            case NAO_AUTH_SRV_UUID_UINT16:
+                ble_nao_auth_c_on_db_disc_evt(&m_ble_nao_auth_c, p_evt);
+                break;
+
+            case NAO_STAT_SRV_UUID_UINT16:
+                ble_nao_stat_c_on_db_disc_evt(&m_ble_nao_stat_c, p_evt);
+                break;
+
+            case NAO_CONF_SRV_UUID_UINT16:
+                ble_nao_conf_c_on_db_disc_evt(&m_ble_nao_conf_c, p_evt);
+                break;
+
+            default:
+                break;
+        }
+    }
 
     if (p_evt->evt_type == BLE_DB_DISCOVERY_AVAILABLE) {
 
@@ -1351,11 +2498,169 @@ void pm_peer_delete_all(void)
 } 
 
 
+/**@brief Function for timing the logging done for each forwarded packet (local command 0x4C).
+ *
+ * @details The STAT packet dump is logged LOG_BENCH_COUNT times at Info and at Debug level. With
+ *          NRF_LOG_DEFERRED a call only stores its arguments, the formatting is done in the idle loop.
+ *          Debug calls are compiled out unless NRF_LOG_DEFAULT_LEVEL is 4. Runs from the main loop
+ *          with interrupts enabled, the pending log is flushed first so the bench starts from an
+ *          empty buffer. Entries the bench pushed out of NRF_LOG_BUFSIZE are counted as dropped
+ *          (entries logged by interrupts meanwhile make that count a lower bound). The results go
+ *          to the watch as [0x69][0x4C][count][Info us, 4 bytes LE][Debug us, 4 bytes LE][dropped, 2 bytes LE].
+ */
+static void log_bench(void)
+{
+  static const uint8_t data[6] = {0x20, 0x03, 0x00, 0x00, 0x00, 0x00};
+  uint8_t    notif_buffer[13];
+  uint32_t   start;
+  uint32_t   info_us;
+  uint32_t   debug_us;
+  uint32_t   issued = (NRF_LOG_LEVEL >= NRF_LOG_SEVERITY_DEBUG) ? 2 * LOG_BENCH_COUNT : LOG_BENCH_COUNT;
+  uint32_t   kept = 0;
+  uint16_t   dropped;
+  ret_code_t err_code;
+
+  while(NRF_LOG_PROCESS())
+   ;
+
+  start = app_timer_cnt_get();
+  for(uint8_t i = 0; i < LOG_BENCH_COUNT; i++)
+   NRF_LOG_INFO("bytes 0-5: %02x,%02x,%02x,%02x,%02x,%02x\r\n",data[0],data[1],data[2],data[3],data[4],data[5]);
+  info_us = nao_boot_prof_ticks_to_us(app_timer_cnt_diff_compute(app_timer_cnt_get(), start));
+
+  start = app_timer_cnt_get();
+  for(uint8_t i = 0; i < LOG_BENCH_COUNT; i++)
+   NRF_LOG_DEBUG("bytes 0-5: %02x,%02x,%02x,%02x,%02x,%02x\r\n",data[0],data[1],data[2],data[3],data[4],data[5]);
+  debug_us = nao_boot_prof_ticks_to_us(app_timer_cnt_diff_compute(app_timer_cnt_get(), start));
+
+#if NRF_LOG_DEFERRED
+  // NRF_LOG_PROCESS() handles one entry and tells if more are left, the bench left at least one
+  do
+   kept++;
+  while(NRF_LOG_PROCESS());
+#else
+  kept = issued;  // processed in place, nothing can be dropped
+#endif
+  dropped = (kept < issued) ? (issued - kept) : 0;
+
+  NRF_LOG_INFO("log bench: %d calls, Info %d us, Debug %d us, %d dropped", LOG_BENCH_COUNT, info_us, debug_us, dropped);
+
+  notif_buffer[0] = 0x69;
+  notif_buffer[1] = 0x4C;
+  notif_buffer[2] = LOG_BENCH_COUNT;
+  uint32_encode(info_us, &notif_buffer[3]);
+  uint32_encode(debug_us, &notif_buffer[7]);
+  uint16_encode(dropped, &notif_buffer[11]);
+  err_code = ble_nao_stat_notif_forward(&m_nao_proxy, notif_buffer, sizeof(notif_buffer));
+  NRF_LOG_INFO("forward notification returned: %d",err_code);
+}
+
+
+/**@brief Function for sending the cycle counts of the hot paths (local command 0x66).
+ *
+ * @details One notification per section: [0x69][0x66][section][count][min][max][mean], each value
+ *          32-bit little endian, in CPU cycles.
+ */
+static void cyc_report(void)
+{
+  nao_cyc_stats_t stats;
+  uint8_t         notif_buffer[19];
+  ret_code_t      err_code;
+
+  for(uint8_t section = 0; section < NAO_CYC_SECTION_COUNT; section++)
+   {
+    nao_cyc_get((nao_cyc_section_t)section, &stats);
+    NRF_LOG_INFO("cycles %d: count %d, min %d, max %d, mean %d", section, stats.count, stats.min, stats.max, stats.mean);
+
+    notif_buffer[0] = 0x69;
+    notif_buffer[1] = 0x66;
+    notif_buffer[2] = section;
+    uint32_encode(stats.count, &notif_buffer[3]);
+    uint32_encode(stats.min, &notif_buffer[7]);
+    uint32_encode(stats.max, &notif_buffer[11]);
+    uint32_encode(stats.mean, &notif_buffer[15]);
+    err_code = ble_nao_stat_notif_forward(&m_nao_proxy, notif_buffer, sizeof(notif_buffer));
+    if(err_code != NRF_SUCCESS)
+     NRF_LOG_INFO("cycle counts of section %d not sent: %d", section, err_code);
+   }
+}
+
+
+/**@brief Function for sending the request latency histograms (local command 0x6C).
+ *
+ * @details One notification per hop: [0x69][0x6C][hop][bucket counts], 8 buckets of 16 bits LE with
+ *          upper bounds 5, 10, 20, 50, 100, 200, 500 ms and open. They are followed by
+ *          [0x69][0x6C][0xFF][timeouts, 32 bits][overflows, 32 bits][max ms of each hop, 16 bits].
+ */
+static void lat_report(void)
+{
+  nao_lat_stats_t const * p_stats = nao_lat_stats_get();
+  uint8_t                 notif_buffer[3 + 2 * NAO_LAT_BUCKET_COUNT];
+  uint8_t                 len;
+  ret_code_t              err_code;
+
+  notif_buffer[0] = 0x69;
+  notif_buffer[1] = 0x6C;
+
+  for(uint8_t hop = 0; hop < NAO_LAT_HOP_COUNT; hop++)
+   {
+    notif_buffer[2] = hop;
+    len = 3;
+    for(uint8_t i = 0; i < NAO_LAT_BUCKET_COUNT; i++)
+     len += uint16_encode(p_stats->hops[hop].buckets[i], &notif_buffer[len]);
+    err_code = ble_nao_stat_notif_forward(&m_nao_proxy, notif_buffer, len);
+    if(err_code != NRF_SUCCESS)
+     NRF_LOG_INFO("latency of hop %d not sent: %d", hop, err_code);
+   }
+
+  notif_buffer[2] = 0xFF;
+  len = 3;
+  len += uint32_encode(p_stats->timeouts, &notif_buffer[len]);
+  len += uint32_encode(p_stats->overflows, &notif_buffer[len]);
+  for(uint8_t hop = 0; hop < NAO_LAT_HOP_COUNT; hop++)
+   len += uint16_encode(p_stats->hops[hop].max_ms, &notif_buffer[len]);
+  err_code = ble_nao_stat_notif_forward(&m_nao_proxy, notif_buffer, len);
+  NRF_LOG_INFO("latency: timeouts %d, overflows %d, max %d/%d/%d ms", p_stats->timeouts, p_stats->overflows,
+               p_stats->hops[NAO_LAT_HOP_PROXY].max_ms, p_stats->hops[NAO_LAT_HOP_LAMP].max_ms, p_stats->hops[NAO_LAT_HOP_TOTAL].max_ms);
+}
+
+
+/**@brief Function for sending the proxy statistics pages first to last - 1 (local command 0x99).
+ *
+ * @details One notification per page, layout in nao_stats.h.
+ */
+static void stats_report(uint8_t first, uint8_t last)
+{
+  uint8_t    notif_buffer[NAO_STATS_PAGE_LEN];
+  uint8_t    len;
+  ret_code_t err_code;
+
+  for(uint8_t page = first; page < last; page++)
+   {
+    len = nao_stats_page_encode(page, nao_cache_time_ms(), notif_buffer);
+    if(len == 0)
+     {
+      NRF_LOG_INFO("no statistics page %d", page);
+      return;
+     }
+    err_code = ble_nao_stat_notif_forward(&m_nao_proxy, notif_buffer, len);
+    if(err_code != NRF_SUCCESS)
+     NRF_LOG_INFO("statistics page %d not sent: %d", page, err_code);
+   }
+}
+
+
 uint32_t proxy_local_cmd(uint8_t const *nao_write_data, uint16_t nao_write_data_len)
  {
    // CMD 0x11: erase bonds, restart
    // CMD 0x22: set NAO name (write setting to flash, erase bonds, restart)
    // CMD 0x33: get NAO name 
+   // CMD 0x55: watch menu opened (0x01) or closed (0x00)
+   // CMD 0x4C: time the packet path logging
+   // CMD 0x66: get cycle counts of the hot paths, 0x66 0x01 clears them after sending
+   // CMD 0x6C: get request latency histograms, 0x6C 0x01 clears them after sending
+   // CMD 0x99: get proxy statistics, all pages or the page in the next byte
+   // CMD 0x9A: clear proxy statistics
    switch(nao_write_data[1])
     {
      case 0x11:
@@ -1364,7 +2669,7 @@ uint32_t proxy_local_cmd(uint8_t const *nao_write_data, uint16_t nao_write_data_
        NVIC_SystemReset();
        break;
      case 0x22:
-       NRF_LOG_INFO("Local command 0x22 - set NAO name and restart (got: %s)",nao_write_data+2);
+       NRF_LOG_INFO("Local command 0x22 - set NAO name and restart");
        if((nao_write_data_len > 2) && (nao_write_data_len < MAXNAME + 2))
         {
          const uint8_t *ptr;
@@ -1372,6 +2677,7 @@ uint32_t proxy_local_cmd(uint8_t const *nao_write_data, uint16_t nao_write_data_
          ptr = nao_write_data+2;
          memcpy(m_target_periph_name,ptr,nao_write_data_len-2);
          memcpy(m_target_periph_name+nao_write_data_len-2,&terminator,1);
+         NRF_LOG_INFO("new NAO name: %s",m_target_periph_name);
          write_cfg_to_flash();
          pm_peer_delete_all();
         }
@@ -1384,22 +2690,95 @@ uint32_t proxy_local_cmd(uint8_t const *nao_write_data, uint16_t nao_write_data_
        notif_buffer[0] = 0x77;
        notif_buffer[1] = 0x77;
        strcpy((char *)notif_buffer+2, (char *)m_target_periph_name);
-       NRF_LOG_INFO("sending NAO name: %s",notif_buffer+2);
+       NRF_LOG_INFO("sending NAO name: %s",m_target_periph_name);
        err_code = ble_nao_stat_notif_forward(&m_nao_proxy,notif_buffer,20);
        NRF_LOG_INFO("forward notification returned: %d",err_code);
-       free(notif_buffer);
        break;
      case 0x44:
        NRF_LOG_INFO("Local command 0x44 - reset proxy");
        NVIC_SystemReset();
        break;
+     case 0x55:
+       NRF_LOG_INFO("Local command 0x55 - watch menu %s",(nao_write_data_len > 2) && nao_write_data[2] ? "open" : "closed");
+       if(nao_conn_policy_menu_set((nao_write_data_len > 2) && (nao_write_data[2] != 0), nao_cache_time_ms()))
+        conn_params_apply();
+       break;
+     case 0x4C:
+       NRF_LOG_INFO("Local command 0x4C - log benchmark");
+       log_bench();
+       break;
+     case 0x66:
+       NRF_LOG_INFO("Local command 0x66 - cycle counts");
+       cyc_report();
+       if((nao_write_data_len > 2) && (nao_write_data[2] == 0x01))
+        nao_cyc_reset();
+       break;
+     case 0x6C:
+       NRF_LOG_INFO("Local command 0x6C - latency histograms");
+       lat_report();
+       if((nao_write_data_len > 2) && (nao_write_data[2] == 0x01))
+        nao_lat_reset();
+       break;
+     case 0x99:
+       NRF_LOG_INFO("Local command 0x99 - statistics");
+       if(nao_write_data_len > 2)
+        stats_report(nao_write_data[2], nao_write_data[2] + 1);
+       else
+        stats_report(0, NAO_STATS_PAGE_COUNT);
+       break;
+     case 0x9A:
+       NRF_LOG_INFO("Local command 0x9A - clear statistics");
+       nao_stats_reset(nao_cache_time_ms());
+       break;
 
     }
    return NRF_SUCCESS;
  }
 
 
-static void nao_write_handler(nao_proxy_t * p_lbs, uint8_t const *nao_write_data, uint16_t nao_write_data_len)
+/**@brief Function for answering a conf read (0x09 0x73 register) from the lamp state cache.
+ *
+ * @details A cached value is sent to the watch right away. A stale one is also refreshed from the
+ *          lamp, the new value follows as soon as the lamp answers.
+ *
+ * @return true if the cached value was fresh and the lamp does not need to be asked.
+ */
+static bool conf_read_from_cache(uint8_t const *nao_write_data, uint16_t nao_write_data_len)
+{
+  nao_cache_entry_t const * p_entry;
+  ret_code_t err_code;
+
+  if((nao_write_data_len != 3) || (nao_write_data[1] != 0x73))
+   return false;
+
+  p_entry = nao_cache_get((nao_write_data[1] << 8) | nao_write_data[2]);
+  if(p_entry == NULL)
+   return false;
+
+  err_code = ble_nao_stat_notif_forward(&m_nao_proxy, (uint8_t *)p_entry->data, p_entry->len);
+  if(err_code == NRF_SUCCESS)
+   {
+    nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_FORWARDED);
+    nao_lat_watch_tx(0x09, lat_msg_type(p_entry->data, p_entry->len));
+   }
+  NRF_LOG_DEBUG("answered %02x%02x from cache (age %d ms): %d", nao_write_data[1], nao_write_data[2], nao_cache_time_ms() - p_entry->stamp_ms, err_code);
+
+  return nao_cache_is_fresh(p_entry);
+}
+
+
+/**@brief Function for sending a conf read for the polling schedule.
+ */
+static uint32_t poll_conf_read(uint8_t const *p_cmd, uint16_t len)
+{
+  if(m_conn_handle_nao_c == BLE_CONN_HANDLE_INVALID)
+   return NRF_ERROR_INVALID_STATE;
+
+  return ble_nao_characteristic_write(m_ble_nao_conf_c.conn_handle, m_ble_nao_conf_c.handles.nao_conf_tx_handle, p_cmd, len);
+}
+
+
+static void nao_cmd_dispatch(uint8_t const *nao_write_data, uint16_t nao_write_data_len)
 {
   uint8_t const *nao_characteristic_addr;
   uint8_t const *data_buffer = nao_write_data + 1; // increment buffer address by 1 to skip first byte
@@ -1407,42 +2786,82 @@ static void nao_write_handler(nao_proxy_t * p_lbs, uint8_t const *nao_write_data
 
   nao_characteristic_addr = nao_write_data; // first byte in data array is NAO service address: 0x09, 0x13 or 0x68. 0x69 will be a local command to the proxy.
  
-  NRF_LOG_INFO("Received write from peripheral: %X, %X, %X, %X, ... (len: %d)",nao_write_data[0], nao_write_data[1], nao_write_data[2], nao_write_data[3],nao_write_data_len);
+  NRF_LOG_DEBUG("Received write from peripheral: %X, %X, %X, %X, ... (len: %d)",nao_write_data[0], nao_write_data[1], nao_write_data[2], nao_write_data[3],nao_write_data_len);
 
   switch(*nao_characteristic_addr)
     {
       case 0x09:
-       NRF_LOG_INFO("write to service 09");
+       NRF_LOG_DEBUG("write to service 09");
        if(m_conn_handle_nao_c != BLE_CONN_HANDLE_INVALID)
         {
+         bool cached;
+
+         // the cache and the poll state are also served from the housekeeping timer
+         CRITICAL_REGION_ENTER();
+         cached = conf_read_from_cache(nao_write_data, nao_write_data_len);
+         if(!cached && (nao_write_data_len > 2) && (nao_write_data[1] == 0x74)) // conf write (0x74 register), cached 0x73 value is outdated
+          nao_cache_invalidate((0x73 << 8) | nao_write_data[2]);
+         if(!cached && (nao_write_data_len > 2) && (nao_write_data[1] == 0x73)) // the reply has to reach the watch even if unchanged
+          nao_poll_watch_request((0x73 << 8) | nao_write_data[2]);
+         CRITICAL_REGION_EXIT();
+         if(cached)
+          break;
+
          err_code =  ble_nao_characteristic_write(m_ble_nao_conf_c.conn_handle, m_ble_nao_conf_c.handles.nao_conf_tx_handle, data_buffer, nao_write_data_len - 1);
-         APP_ERROR_CHECK(err_code);
+         if(err_code == NRF_ERROR_NO_MEM)
+          {
+           NRF_LOG_INFO("cannot write - NAO TX queue full");
+           nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_WRITE_FAIL);
+          }
+         else
+          APP_ERROR_CHECK(err_code);
         }
        else
-        NRF_LOG_INFO("cannot write - NAO not connected");
+        {
+         NRF_LOG_INFO("cannot write - NAO not connected");
+         nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_WRITE_FAIL);
+        }
        break;
       case 0x13:
-       NRF_LOG_INFO("write to service 13");
+       NRF_LOG_DEBUG("write to service 13");
        if(m_conn_handle_nao_c != BLE_CONN_HANDLE_INVALID)
         {
          err_code =  ble_nao_characteristic_write(m_ble_nao_auth_c.conn_handle, m_ble_nao_auth_c.handles.nao_auth_tx_handle, data_buffer, nao_write_data_len - 1);
-         APP_ERROR_CHECK(err_code);
+         if(err_code == NRF_ERROR_NO_MEM)
+          {
+           NRF_LOG_INFO("cannot write - NAO TX queue full");
+           nao_stats_srv_evt(NAO_STATS_SRV_AUTH, NAO_STATS_EVT_WRITE_FAIL);
+          }
+         else
+          APP_ERROR_CHECK(err_code);
         }
        else
-        NRF_LOG_INFO("cannot write - NAO not connected");       
+        {
+         NRF_LOG_INFO("cannot write - NAO not connected");
+         nao_stats_srv_evt(NAO_STATS_SRV_AUTH, NAO_STATS_EVT_WRITE_FAIL);
+        }
        break;
       case 0x68:
-       NRF_LOG_INFO("write to service 68");
+       NRF_LOG_DEBUG("write to service 68");
        if(m_conn_handle_nao_c != BLE_CONN_HANDLE_INVALID)
         {
          err_code =  ble_nao_characteristic_write(m_ble_nao_stat_c.conn_handle, m_ble_nao_stat_c.handles.nao_stat_tx_handle, data_buffer, nao_write_data_len - 1);
-         APP_ERROR_CHECK(err_code);
+         if(err_code == NRF_ERROR_NO_MEM)
+          {
+           NRF_LOG_INFO("cannot write - NAO TX queue full");
+           nao_stats_srv_evt(NAO_STATS_SRV_STAT, NAO_STATS_EVT_WRITE_FAIL);
+          }
+         else
+          APP_ERROR_CHECK(err_code);
         }
        else
-        NRF_LOG_INFO("cannot write - NAO not connected");
+        {
+         NRF_LOG_INFO("cannot write - NAO not connected");
+         nao_stats_srv_evt(NAO_STATS_SRV_STAT, NAO_STATS_EVT_WRITE_FAIL);
+        }
        break;
       case 0x69:
-       NRF_LOG_INFO("local proxy command (69)");
+       NRF_LOG_DEBUG("local proxy command (69)");
        if(nao_write_data_len>1)
         proxy_local_cmd(nao_write_data, nao_write_data_len);
     }
@@ -1450,6 +2869,166 @@ static void nao_write_handler(nao_proxy_t * p_lbs, uint8_t const *nao_write_data
 }
 
 
+/**@brief Function for getting the message type of the reply a watch command is answered with, 0 if there is none.
+ */
+static uint16_t batch_reply_type(uint8_t const *nao_cmd, uint16_t nao_cmd_len)
+{
+  if((nao_cmd_len >= 3) && (nao_cmd[0] == 0x09) && (nao_cmd[1] == 0x73))
+   return (0x73 << 8) | nao_cmd[2];  // CONF register read
+  if((nao_cmd_len >= 2) && (nao_cmd[0] == 0x69) && (nao_cmd[1] == 0x33))
+   return 0x7777;                     // NAO name from the proxy
+  return 0;
+}
+
+
+/**@brief Function for handling a batched write: NAO_PROXY_BATCH_CMD, then [length][command] for each command.
+ *
+ * @details Every command is routed like a single write, nested batches are skipped. Notifications
+ *          to the watch are held back until each command that is answered had its reply or
+ *          BATCH_RESPONSE_TIMEOUT expired, so the replies go out together.
+ */
+static void nao_batch_dispatch(uint8_t const *nao_write_data, uint16_t nao_write_data_len)
+{
+  uint16_t offset;
+  uint8_t  cmd_count = 0;
+  uint16_t reply_types[NAO_PROXY_NOTIF_QUEUE_SIZE];
+  uint8_t  reply_count = 0;
+  uint16_t reply_type;
+  ret_code_t err_code;
+
+  // validate the whole batch before sending anything
+  for(offset = 1; offset < nao_write_data_len; offset += 1 + nao_write_data[offset])
+   {
+    if((nao_write_data[offset] == 0) || (offset + 1 + nao_write_data[offset] > nao_write_data_len))
+     {
+      NRF_LOG_INFO("batch command malformed at offset %d, ignored", offset);
+      return;
+     }
+    cmd_count++;
+
+    reply_type = batch_reply_type(nao_write_data + offset + 1, nao_write_data[offset]);
+    if((reply_type != 0) && (reply_count < ARRAY_SIZE(reply_types)))
+     reply_types[reply_count++] = reply_type;
+   }
+
+  NRF_LOG_INFO("batch of %d commands, %d replies expected", cmd_count, reply_count);
+
+  nao_proxy_notif_hold(&m_nao_proxy, reply_types, reply_count);
+
+  for(offset = 1; offset < nao_write_data_len; offset += 1 + nao_write_data[offset])
+   {
+    if(nao_write_data[offset + 1] != NAO_PROXY_BATCH_CMD)
+     nao_cmd_dispatch(nao_write_data + offset + 1, nao_write_data[offset]);
+   }
+
+  err_code = app_timer_stop(m_batch_timer_id);
+  APP_ERROR_CHECK(err_code);
+  err_code = app_timer_start(m_batch_timer_id, BATCH_RESPONSE_TIMEOUT, NULL);
+  APP_ERROR_CHECK(err_code);
+}
+
+
+static void nao_write_process(uint8_t const *nao_write_data, uint16_t nao_write_data_len)
+{
+  if(nao_write_data_len == 0)
+   return;
+
+  if(nao_write_data[0] == NAO_PROXY_BATCH_CMD)
+   nao_batch_dispatch(nao_write_data, nao_write_data_len);
+  else
+   nao_cmd_dispatch(nao_write_data, nao_write_data_len);
+}
+
+
+/**@brief Function for starting the latency trace of a command to a NAO+ service.
+ */
+static void lat_cmd_rx(uint8_t const *nao_cmd, uint16_t nao_cmd_len)
+{
+  // only CONF and STAT answers are forwarded to the watch
+  if((nao_cmd_len >= 2) && ((nao_cmd[0] == 0x09) || (nao_cmd[0] == 0x68)))
+   nao_lat_watch_rx(nao_cmd[0], lat_msg_type(nao_cmd + 1, nao_cmd_len - 1));
+}
+
+
+/**@brief Function for starting the latency trace of the commands in a watch write.
+ */
+static void lat_watch_rx(uint8_t const *nao_write_data, uint16_t nao_write_data_len)
+{
+  uint16_t offset;
+
+  if((nao_write_data_len == 0) || (nao_write_data[0] != NAO_PROXY_BATCH_CMD))
+   {
+    lat_cmd_rx(nao_write_data, nao_write_data_len);
+    return;
+   }
+
+  for(offset = 1; (offset < nao_write_data_len) && (nao_write_data[offset] != 0) &&
+                  (offset + 1 + nao_write_data[offset] <= nao_write_data_len); offset += 1 + nao_write_data[offset])
+   lat_cmd_rx(nao_write_data + offset + 1, nao_write_data[offset]);
+}
+
+
+/**@brief Function for counting the lamp writes and time stamping those of traced watch requests.
+ */
+static void lamp_write_observer(uint16_t conn_handle, uint16_t attr_handle, uint8_t const *p_value, uint16_t len)
+{
+  if(attr_handle == m_ble_nao_conf_c.handles.nao_conf_tx_handle)
+   {
+    nao_stats_srv_evt(NAO_STATS_SRV_CONF, NAO_STATS_EVT_WRITE);
+    nao_lat_lamp_tx(0x09, lat_msg_type(p_value, len));
+   }
+  else if(attr_handle == m_ble_nao_stat_c.handles.nao_stat_tx_handle)
+   {
+    nao_stats_srv_evt(NAO_STATS_SRV_STAT, NAO_STATS_EVT_WRITE);
+    nao_lat_lamp_tx(0x68, lat_msg_type(p_value, len));
+   }
+  else if(attr_handle == m_ble_nao_auth_c.handles.nao_auth_tx_handle)
+   nao_stats_srv_evt(NAO_STATS_SRV_AUTH, NAO_STATS_EVT_WRITE);
+}
+
+
+static void nao_write_handler(nao_proxy_t * p_lbs, uint8_t const *nao_write_data, uint16_t nao_write_data_len)
+{
+  uint32_t err_code;
+
+  NAO_CYC_START(NAO_CYC_WRITE_HANDLER);
+
+  lat_watch_rx(nao_write_data, nao_write_data_len);
+
+  // handled in the main loop by nao_write_process()
+  err_code = nao_pipe_put(NAO_PIPE_PRIO_HIGH, NAO_PIPE_SRC_WATCH, nao_write_data, nao_write_data_len);
+  if(err_code != NRF_SUCCESS)
+   NRF_LOG_INFO("watch command dropped: %d", err_code);
+
+  NAO_CYC_STOP(NAO_CYC_WRITE_HANDLER);
+}
+
+
+/**@brief Function for handling a packet queued by the SoftDevice observers, called from the main loop.
+ */
+static void pipe_handler(nao_pipe_src_t src, uint8_t const * p_data, uint16_t len)
+{
+  switch(src)
+   {
+    case NAO_PIPE_SRC_WATCH:
+     nao_write_process(p_data, len);
+     break;
+    case NAO_PIPE_SRC_AUTH:
+     auth_rx_process(p_data, len);
+     break;
+    case NAO_PIPE_SRC_STAT:
+     stat_rx_process(p_data, len);
+     break;
+    case NAO_PIPE_SRC_CONF:
+     conf_rx_process(p_data, len);
+     break;
+    case NAO_PIPE_SRC_REPLAY:
+     cache_replay();
+     break;
+   }
+}
+
+
 /**@brief Function for initializing services that will be used by the application.
  */
 static void services_init(void)
@@ -1475,7 +3054,7 @@ static void services_init(void)
 /**@brief Function for initializing the Advertising functionality.
  *
  * @details Encodes the required advertising data and passes it to the stack.
- *          Also builds a structure to be passed to the stack when starting advertising.
+ *          Also looks up a bonded watch as the target of directed advertising.
  */
 static void advertising_init(void)
 {
@@ -1503,20 +3082,49 @@ static void advertising_init(void)
     err_code = ble_advdata_encode(&srdata, m_adv_data.scan_rsp_data.p_data, &m_adv_data.scan_rsp_data.len);
     APP_ERROR_CHECK(err_code);
 
-    ble_gap_adv_params_t adv_params;
+    // The advertising set is configured for each stage in advertising_start().
+    watch_addr_load();
+    peer_identities_update();  // no role is active yet
+}
 
-    // Set advertising parameters.
-    memset(&adv_params, 0, sizeof(adv_params));
 
-    adv_params.primary_phy     = BLE_GAP_PHY_1MBPS;
-    adv_params.duration        = APP_ADV_DURATION;
-    adv_params.properties.type = BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED;
-    adv_params.p_peer_addr     = NULL;
-    adv_params.filter_policy   = BLE_GAP_ADV_FP_ANY;
-    adv_params.interval        = APP_ADV_INTERVAL;
+/**@brief Function for the initialization which can wait until the proxy advertises.
+ *
+ * @details The lamp side (NAO+ name from flash, scanning, discovery, the NAO+ clients) is only used
+ *          once a watch connected. A watch which connected before this finished gets its scan
+ *          started here.
+ */
+static void deferred_init(void)
+{
+    ret_code_t err_code;
+
+    read_cfg_from_flash();
+    nao_boot_prof_mark("read_cfg");
+
+    scan_init();
+    NAO_register_UUIDs();
+    db_discovery_init();
+    nao_auth_c_init();
+    nao_stat_c_init();
+    nao_conf_c_init();
+    nao_boot_prof_mark("nao_clients");
 
-    err_code = sd_ble_gap_adv_set_configure(&m_adv_handle, &m_adv_data, &adv_params);
+    err_code = tx_buffer_init();
     APP_ERROR_CHECK(err_code);
+    nao_generic_write_observer_set(lamp_write_observer);
+    nao_poll_init(poll_conf_read);
+    nao_filter_init();
+    nao_boot_prof_mark("nao_modules");
+
+    m_deferred_init_done = true;
+
+    if((m_nao_proxy.conn_handle != BLE_CONN_HANDLE_INVALID) && (m_conn_handle_nao_c == BLE_CONN_HANDLE_INVALID) && !m_scan_active)
+     {
+      nao_scan_policy_burst(nao_cache_time_ms());
+      scan_start();
+     }
+
+    nao_boot_prof_dump();
 }
 
 
@@ -1540,36 +3148,41 @@ int main(void)
 
     NAO_found = 0;
 
-    // Initialize.
+    // Initialize. The RTC runs first, it time stamps the init stages.
+    timer_init();
+    nao_boot_prof_start();
+    nao_cyc_init();
+
     log_init();
+    nao_boot_prof_mark("log");
 
     NRF_LOG_INFO("Starting program...");    
 
-    timer_init();
     create_timers();
 
-    err_code = app_timer_start(m_scheduler_timer_id, APP_TIMER_TICKS(200), NULL);
+    err_code = app_timer_start(m_scheduler_timer_id, APP_TIMER_TICKS(HOUSEKEEPING_INTERVAL_MS), NULL);
     APP_ERROR_CHECK(err_code);
+    nao_boot_prof_mark("timers");
 
     power_management_init();
+    nao_pipe_init(pipe_handler);
     ble_stack_init();
+    nao_boot_prof_mark("ble_stack");
+
     my_fds_init();
-    read_cfg_from_flash();
-    scan_init();
     gap_params_init();
     gatt_init();
     conn_params_init();
-    NAO_register_UUIDs();
-    db_discovery_init();
+    nao_boot_prof_mark("gap_gatt");
+
     peer_manager_init();
     // pm_peer_delete_all(); 
- 
-    nao_auth_c_init();   
-    nao_stat_c_init();
-    nao_conf_c_init();
+    nao_boot_prof_mark("peer_manager");
 
     services_init();
+    nao_stats_init(&m_nao_proxy);
     advertising_init();
+    nao_boot_prof_mark("services");
 
 
     // Start execution.
@@ -1584,11 +3197,17 @@ int main(void)
     {
         adv_scan_start();
     }
+    nao_boot_prof_mark("advertising");
+
+    // The proxy is discoverable now, the rest is only needed once a watch connected.
+    deferred_init();
 
     // Enter main loop.
-    // Application is entirely event-driven, except timer-triggered housekeeping routine
+    // Application is entirely event-driven, except timer-triggered housekeeping routine.
+    // SoftDevice observers only queue lamp and watch packets, they are parsed, cached and forwarded here.
     for (;;)
     {
+        nao_pipe_execute();
         idle_state_handle();
     }
 }
@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "nao_adv_policy.h"
+#include "nrf_log.h"
+
+
+/**@brief Advertising parameters of one stage. Interval in 0.625 ms units, duration in 10 ms units. */
+typedef struct
+{
+    uint8_t  type;
+    uint32_t interval;
+    uint16_t duration;  /**< 0 advertises until a connection. */
+} adv_stage_params_t;
+
+static const adv_stage_params_t m_stages[NAO_ADV_STAGE_COUNT] =
+{
+    [NAO_ADV_STAGE_DIRECTED] = {BLE_GAP_ADV_TYPE_CONNECTABLE_NONSCANNABLE_DIRECTED_HIGH_DUTY_CYCLE, 0,    BLE_GAP_ADV_TIMEOUT_HIGH_DUTY_MAX},
+    [NAO_ADV_STAGE_FAST]     = {BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED,                  32,   NAO_ADV_FAST_MS / 10},  // 20 ms
+    [NAO_ADV_STAGE_SLOW]     = {BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED,                  1636, 0},                     // 1022.5 ms
+};
+
+static nao_adv_stage_t m_stage = NAO_ADV_STAGE_FAST;
+
+
+void nao_adv_policy_restart(bool directed)
+{
+    m_stage = directed ? NAO_ADV_STAGE_DIRECTED : NAO_ADV_STAGE_FAST;
+}
+
+
+bool nao_adv_policy_next(void)
+{
+    if (m_stages[m_stage].duration == 0)
+    {
+        return false;
+    }
+
+    m_stage++;
+
+    NRF_LOG_INFO("advertising stage %d: interval %d", m_stage, m_stages[m_stage].interval);
+
+    return true;
+}
+
+
+nao_adv_stage_t nao_adv_policy_stage_get(void)
+{
+    return m_stage;
+}
+
+
+void nao_adv_policy_params_apply(ble_gap_adv_params_t * p_adv_params)
+{
+    p_adv_params->properties.type = m_stages[m_stage].type;
+    p_adv_params->interval        = m_stages[m_stage].interval;
+    p_adv_params->duration        = m_stages[m_stage].duration;
+}
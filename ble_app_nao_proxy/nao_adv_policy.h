@@ -0,0 +1,39 @@
+#ifndef NAO_ADV_POLICY_H__
+#define NAO_ADV_POLICY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+
+/**@brief Advertising stages, from fast watch reconnection to battery saving. */
+typedef enum
+{
+    NAO_ADV_STAGE_DIRECTED,  /**< High duty cycle directed advertising to the last watch, 1.28 s. */
+    NAO_ADV_STAGE_FAST,      /**< Undirected, 20 ms interval. */
+    NAO_ADV_STAGE_SLOW,      /**< Undirected, about 1 s interval, kept until a watch connects. */
+    NAO_ADV_STAGE_COUNT
+} nao_adv_stage_t;
+
+#ifndef NAO_ADV_FAST_MS
+#define NAO_ADV_FAST_MS  30000     /**< Time spent in NAO_ADV_STAGE_FAST. */
+#endif
+
+/**@brief Function for restarting the stages.
+ *
+ * @param[in]   directed   true if a watch address is known, the stages start with directed advertising.
+ */
+void nao_adv_policy_restart(bool directed);
+
+/**@brief Function for advancing the stage after the advertising set timed out.
+ *
+ * @return false if the last stage timed out, which does not happen with the built-in stages.
+ */
+bool nao_adv_policy_next(void);
+
+/**@brief Function for getting the current stage. */
+nao_adv_stage_t nao_adv_policy_stage_get(void);
+
+/**@brief Function for setting type, interval and duration of the current stage in advertising parameters. */
+void nao_adv_policy_params_apply(ble_gap_adv_params_t * p_adv_params);
+
+#endif // NAO_ADV_POLICY_H__
@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include "nao_boot_prof.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+
+
+static nao_boot_prof_entry_t m_entries[NAO_BOOT_PROF_STAGES];
+static uint8_t               m_count;
+static uint32_t              m_start_ticks;
+
+
+void nao_boot_prof_start(void)
+{
+    m_count       = 0;
+    m_start_ticks = app_timer_cnt_get();
+}
+
+
+void nao_boot_prof_mark(char const * p_name)
+{
+    if (m_count >= NAO_BOOT_PROF_STAGES)
+    {
+        return;
+    }
+
+    m_entries[m_count].p_name = p_name;
+    m_entries[m_count].ticks  = app_timer_cnt_diff_compute(app_timer_cnt_get(), m_start_ticks);
+    m_count++;
+}
+
+
+uint8_t nao_boot_prof_get(nao_boot_prof_entry_t const ** pp_entries)
+{
+    *pp_entries = m_entries;
+
+    return m_count;
+}
+
+
+uint32_t nao_boot_prof_ticks_to_us(uint32_t ticks)
+{
+    return (uint32_t)(((uint64_t)ticks * 1000000) / APP_TIMER_CLOCK_FREQ);
+}
+
+
+void nao_boot_prof_dump(void)
+{
+    uint32_t prev_ticks = 0;
+
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        NRF_LOG_INFO("boot %s: %d us (at %d us)", m_entries[i].p_name,
+                     nao_boot_prof_ticks_to_us(m_entries[i].ticks - prev_ticks),
+                     nao_boot_prof_ticks_to_us(m_entries[i].ticks));
+        prev_ticks = m_entries[i].ticks;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef NAO_BOOT_PROF_H__
+#define NAO_BOOT_PROF_H__
+
+#include <stdint.h>
+
+#ifndef NAO_BOOT_PROF_STAGES
+#define NAO_BOOT_PROF_STAGES  24     /**< Init stages recorded, later marks are ignored. */
+#endif
+
+/**@brief One init stage, time stamped when it finished. */
+typedef struct
+{
+    char const * p_name;    /**< Stage name, must be a string literal. */
+    uint32_t     ticks;     /**< RTC ticks since the profiler was started. */
+} nao_boot_prof_entry_t;
+
+/**@brief Function for starting the profiler, right after app_timer_init() started the RTC. */
+void nao_boot_prof_start(void);
+
+/**@brief Function for time stamping the end of an init stage. */
+void nao_boot_prof_mark(char const * p_name);
+
+/**@brief Function for getting the recorded stages.
+ *
+ * @return Number of entries in *pp_entries.
+ */
+uint8_t nao_boot_prof_get(nao_boot_prof_entry_t const ** pp_entries);
+
+/**@brief Function for converting profiler ticks to microseconds. */
+uint32_t nao_boot_prof_ticks_to_us(uint32_t ticks);
+
+/**@brief Function for logging the time spent in each stage. */
+void nao_boot_prof_dump(void);
+
+#endif // NAO_BOOT_PROF_H__
@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nao_cache.h"
+#include "nrf_log.h"
+
+
+static nao_cache_entry_t m_cache[NAO_CACHE_SIZE];
+static uint32_t          m_time_ms;
+
+
+/**@brief Function for getting the NAO+ message type of a message (first two bytes, big endian).
+ */
+static uint16_t msg_type(uint8_t const * p_data, uint16_t len)
+{
+    return (len >= 2) ? (uint16_t)((p_data[0] << 8) | p_data[1]) : 0;
+}
+
+
+static nao_cache_entry_t * entry_find(uint16_t type)
+{
+    for (uint8_t i = 0; i < NAO_CACHE_SIZE; i++)
+    {
+        if (m_cache[i].type == type)
+        {
+            return &m_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+void nao_cache_tick(uint32_t elapsed_ms)
+{
+    m_time_ms += elapsed_ms;
+}
+
+
+uint32_t nao_cache_time_ms(void)
+{
+    return m_time_ms;
+}
+
+
+bool nao_cache_update(uint8_t const * p_data, uint16_t len)
+{
+    uint16_t            type    = msg_type(p_data, len);
+    nao_cache_entry_t * p_entry;
+    bool                changed;
+
+    if ((type == 0) || (len > NAO_PACKET_SIZE))
+    {
+        return true;
+    }
+
+    p_entry = entry_find(type);
+
+    if (p_entry == NULL)
+    {
+        // Take a free entry, or the one which has not been updated for the longest time.
+        p_entry = &m_cache[0];
+        for (uint8_t i = 0; i < NAO_CACHE_SIZE; i++)
+        {
+            if (m_cache[i].type == 0)
+            {
+                p_entry = &m_cache[i];
+                break;
+            }
+            if ((m_time_ms - m_cache[i].stamp_ms) > (m_time_ms - p_entry->stamp_ms))
+            {
+                p_entry = &m_cache[i];
+            }
+        }
+
+        p_entry->type = type;
+        changed       = true;
+    }
+    else
+    {
+        changed = (p_entry->len != len) || (memcmp(p_entry->data, p_data, len) != 0);
+    }
+
+    memcpy(p_entry->data, p_data, len);
+    p_entry->len      = len;
+    p_entry->stamp_ms = m_time_ms;
+
+    return changed;
+}
+
+
+nao_cache_entry_t const * nao_cache_get(uint16_t type)
+{
+    return (type == 0) ? NULL : entry_find(type);
+}
+
+
+bool nao_cache_is_fresh(nao_cache_entry_t const * p_entry)
+{
+    return (p_entry != NULL) && ((m_time_ms - p_entry->stamp_ms) <= NAO_CACHE_MAX_AGE_MS);
+}
+
+
+void nao_cache_invalidate(uint16_t type)
+{
+    nao_cache_entry_t * p_entry = (type == 0) ? NULL : entry_find(type);
+
+    if (p_entry != NULL)
+    {
+        memset(p_entry, 0, sizeof(nao_cache_entry_t));
+    }
+}
+
+
+void nao_cache_clear(void)
+{
+    NRF_LOG_INFO("lamp state cache cleared");
+    memset(m_cache, 0, sizeof(m_cache));
+}
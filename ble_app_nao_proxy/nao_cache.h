@@ -0,0 +1,54 @@
+#ifndef NAO_CACHE_H__
+#define NAO_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nao_proxychar.h"
+
+#ifndef NAO_CACHE_SIZE
+#define NAO_CACHE_SIZE         8       /**< Number of NAO+ message types kept in the lamp state cache. */
+#endif
+
+#ifndef NAO_CACHE_MAX_AGE_MS
+#define NAO_CACHE_MAX_AGE_MS   30000   /**< Age after which a cached value is answered but also refreshed from the lamp. */
+#endif
+
+/**@brief Last value of one NAO+ message type as received from the lamp. */
+typedef struct
+{
+    uint16_t type;                     /**< NAO+ message type (first two bytes, big endian), 0 for an unused entry. */
+    uint16_t len;
+    uint32_t stamp_ms;                 /**< Proxy uptime when the value was received. */
+    uint8_t  data[NAO_PACKET_SIZE];
+} nao_cache_entry_t;
+
+/**@brief Function for advancing the cache clock, called from the housekeeping timer. */
+void nao_cache_tick(uint32_t elapsed_ms);
+
+/**@brief Function for getting the proxy uptime as seen by the cache. */
+uint32_t nao_cache_time_ms(void);
+
+/**@brief Function for storing a message received from the lamp.
+ *
+ * @details When the cache is full, the least recently updated entry is replaced.
+ *
+ * @return true if the message type was not cached yet or its value changed.
+ */
+bool nao_cache_update(uint8_t const * p_data, uint16_t len);
+
+/**@brief Function for looking up the cached value of a message type.
+ *
+ * @return The entry, or NULL if nothing has been received for this type.
+ */
+nao_cache_entry_t const * nao_cache_get(uint16_t type);
+
+/**@brief Function for checking whether a cached value is recent enough to answer without asking the lamp. */
+bool nao_cache_is_fresh(nao_cache_entry_t const * p_entry);
+
+/**@brief Function for dropping the cached value of a message type, e.g. after the watch changed it. */
+void nao_cache_invalidate(uint16_t type);
+
+/**@brief Function for dropping all cached values, e.g. when the lamp disconnects. */
+void nao_cache_clear(void);
+
+#endif // NAO_CACHE_H__
@@ -0,0 +1,166 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nao_conn_policy.h"
+#include "nrf_log.h"
+
+
+// Intervals in 1.25 ms units, supervision timeout in 10 ms units.
+static const ble_gap_conn_params_t m_profiles[NAO_CONN_PROFILE_COUNT] =
+{
+    [NAO_CONN_PROFILE_PAIRING]     = {12, 24,  0, 400},   // 15-30 ms, 4 s
+    [NAO_CONN_PROFILE_INTERACTIVE] = {6,  12,  0, 400},   // 7.5-15 ms, 4 s
+    [NAO_CONN_PROFILE_IDLE]        = {80, 160, 4, 600},   // 100-200 ms, latency 4, 6 s
+    [NAO_CONN_PROFILE_LINGER]      = {400, 800, 0, 600},  // 500-1000 ms, 6 s
+};
+
+static nao_conn_profile_t    m_profile = NAO_CONN_PROFILE_IDLE;
+static bool                  m_bringup_pending;
+static bool                  m_linger;
+static bool                  m_menu_open;
+static uint32_t              m_menu_open_ms;
+static nao_conn_link_stats_t m_link_stats[NAO_CONN_LINK_COUNT];
+
+
+/**@brief Function for selecting the profile from the current state.
+ *
+ * @return true if the profile changed.
+ */
+static bool profile_select(void)
+{
+    nao_conn_profile_t profile;
+
+    if (m_menu_open)
+    {
+        profile = NAO_CONN_PROFILE_INTERACTIVE;
+    }
+    else if (m_bringup_pending)
+    {
+        profile = NAO_CONN_PROFILE_PAIRING;
+    }
+    else if (m_linger)
+    {
+        profile = NAO_CONN_PROFILE_LINGER;
+    }
+    else
+    {
+        profile = NAO_CONN_PROFILE_IDLE;
+    }
+
+    if (profile == m_profile)
+    {
+        return false;
+    }
+
+    NRF_LOG_INFO("connection profile %d -> %d", m_profile, profile);
+    m_profile = profile;
+
+    return true;
+}
+
+
+bool nao_conn_policy_bringup_set(bool pending)
+{
+    m_bringup_pending = pending;
+
+    return profile_select();
+}
+
+
+bool nao_conn_policy_linger_set(bool linger)
+{
+    m_linger = linger;
+
+    return profile_select();
+}
+
+
+bool nao_conn_policy_menu_set(bool open, uint32_t now_ms)
+{
+    m_menu_open    = open;
+    m_menu_open_ms = now_ms;
+
+    return profile_select();
+}
+
+
+bool nao_conn_policy_process(uint32_t now_ms)
+{
+    if (!m_menu_open || ((now_ms - m_menu_open_ms) < NAO_CONN_MENU_MAX_MS))
+    {
+        return false;
+    }
+
+    m_menu_open = false;
+
+    return profile_select();
+}
+
+
+nao_conn_profile_t nao_conn_policy_profile_get(void)
+{
+    return m_profile;
+}
+
+
+void nao_conn_policy_params_get(nao_conn_profile_t profile, ble_gap_conn_params_t * p_params)
+{
+    *p_params = m_profiles[profile];
+}
+
+
+void nao_conn_policy_peer_request(ble_gap_conn_params_t * p_params)
+{
+    ble_gap_conn_params_t const * p_profile = &m_profiles[m_profile];
+
+    if ((p_params->min_conn_interval > p_profile->max_conn_interval) ||
+        (p_params->max_conn_interval < p_profile->min_conn_interval))
+    {
+        *p_params = *p_profile;
+        return;
+    }
+
+    // Narrower interval, less latency and a longer timeout than the profile keep the timeout valid.
+    if (p_params->min_conn_interval < p_profile->min_conn_interval)
+    {
+        p_params->min_conn_interval = p_profile->min_conn_interval;
+    }
+    if (p_params->max_conn_interval > p_profile->max_conn_interval)
+    {
+        p_params->max_conn_interval = p_profile->max_conn_interval;
+    }
+    if (p_params->slave_latency > p_profile->slave_latency)
+    {
+        p_params->slave_latency = p_profile->slave_latency;
+    }
+    if (p_params->conn_sup_timeout < p_profile->conn_sup_timeout)
+    {
+        p_params->conn_sup_timeout = p_profile->conn_sup_timeout;
+    }
+}
+
+
+void nao_conn_policy_link_update(nao_conn_link_t link, ble_gap_conn_params_t const * p_params)
+{
+    nao_conn_link_stats_t * p_stats = &m_link_stats[link];
+
+    p_stats->conn_interval    = p_params->max_conn_interval;
+    p_stats->slave_latency    = p_params->slave_latency;
+    p_stats->conn_sup_timeout = p_params->conn_sup_timeout;
+    p_stats->updates++;
+
+    NRF_LOG_INFO("link %d: interval %d, latency %d, timeout %d",
+                 link, p_stats->conn_interval, p_stats->slave_latency, p_stats->conn_sup_timeout);
+}
+
+
+void nao_conn_policy_link_reset(nao_conn_link_t link)
+{
+    memset(&m_link_stats[link], 0, sizeof(m_link_stats[link]));
+}
+
+
+nao_conn_link_stats_t const * nao_conn_policy_link_stats_get(nao_conn_link_t link)
+{
+    return &m_link_stats[link];
+}
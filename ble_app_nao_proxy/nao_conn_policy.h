@@ -0,0 +1,85 @@
+#ifndef NAO_CONN_POLICY_H__
+#define NAO_CONN_POLICY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+
+/**@brief Connection parameter profiles, applied to both links. */
+typedef enum
+{
+    NAO_CONN_PROFILE_PAIRING,      /**< Lamp bring-up in progress: discovery, bonding, CCCD writes. */
+    NAO_CONN_PROFILE_INTERACTIVE,  /**< Watch menu open, commands need short round trips. */
+    NAO_CONN_PROFILE_IDLE,         /**< Only periodic telemetry flows, long interval with slave latency. */
+    NAO_CONN_PROFILE_LINGER,       /**< Watch gone, the lamp link is only kept up for its return. */
+    NAO_CONN_PROFILE_COUNT
+} nao_conn_profile_t;
+
+/**@brief Links the policy is applied to. */
+typedef enum
+{
+    NAO_CONN_LINK_LAMP,    /**< Proxy is central, the policy sets the parameters. */
+    NAO_CONN_LINK_WATCH,   /**< Proxy is peripheral, the policy requests the parameters. */
+    NAO_CONN_LINK_COUNT
+} nao_conn_link_t;
+
+/**@brief Negotiated parameters of one link. Interval in 1.25 ms units, timeout in 10 ms units. */
+typedef struct
+{
+    uint16_t conn_interval;
+    uint16_t slave_latency;
+    uint16_t conn_sup_timeout;
+    uint16_t updates;           /**< Parameter sets seen on the link, the initial one included. */
+} nao_conn_link_stats_t;
+
+#ifndef NAO_CONN_MENU_MAX_MS
+#define NAO_CONN_MENU_MAX_MS  120000    /**< Back to idle if the watch never reports the menu as closed. */
+#endif
+
+/**@brief Function for noting that a lamp bring-up started (true) or finished (false).
+ *
+ * @return true if the profile changed and has to be applied to the links.
+ */
+bool nao_conn_policy_bringup_set(bool pending);
+
+/**@brief Function for noting that the lamp link lingers without a watch (true) or not (false).
+ *
+ * @return true if the profile changed and has to be applied to the links.
+ */
+bool nao_conn_policy_linger_set(bool linger);
+
+/**@brief Function for noting that the watch menu was opened (true) or closed (false).
+ *
+ * @return true if the profile changed and has to be applied to the links.
+ */
+bool nao_conn_policy_menu_set(bool open, uint32_t now_ms);
+
+/**@brief Function for ending a stale menu, called from the housekeeping timer.
+ *
+ * @return true if the profile changed and has to be applied to the links.
+ */
+bool nao_conn_policy_process(uint32_t now_ms);
+
+/**@brief Function for getting the current profile. */
+nao_conn_profile_t nao_conn_policy_profile_get(void);
+
+/**@brief Function for getting the connection parameters of a profile. */
+void nao_conn_policy_params_get(nao_conn_profile_t profile, ble_gap_conn_params_t * p_params);
+
+/**@brief Function for fitting parameters requested by the lamp into the current profile.
+ *
+ * @details The interval range is narrowed to the profile's range. If the ranges do not overlap,
+ *          the profile's parameters are used instead.
+ */
+void nao_conn_policy_peer_request(ble_gap_conn_params_t * p_params);
+
+/**@brief Function for recording the parameters of a link, on connection and on each update. */
+void nao_conn_policy_link_update(nao_conn_link_t link, ble_gap_conn_params_t const * p_params);
+
+/**@brief Function for clearing the record of a disconnected link. */
+void nao_conn_policy_link_reset(nao_conn_link_t link);
+
+/**@brief Function for getting the negotiated parameters of a link. */
+nao_conn_link_stats_t const * nao_conn_policy_link_stats_get(nao_conn_link_t link);
+
+#endif // NAO_CONN_POLICY_H__
@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <string.h>
+#include "nao_cyc.h"
+#include "app_util_platform.h"
+
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} cyc_section_t;
+
+static cyc_section_t m_sections[NAO_CYC_SECTION_COUNT];
+
+
+void nao_cyc_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
+    nao_cyc_reset();
+}
+
+
+void nao_cyc_record(nao_cyc_section_t section, uint32_t cycles)
+{
+    cyc_section_t * p_section = &m_sections[section];
+
+    // Sections run both in the SoftDevice observers and in the main loop.
+    CRITICAL_REGION_ENTER();
+
+    if ((p_section->count == 0) || (cycles < p_section->min))
+    {
+        p_section->min = cycles;
+    }
+    if (cycles > p_section->max)
+    {
+        p_section->max = cycles;
+    }
+    p_section->sum += cycles;
+    p_section->count++;
+
+    CRITICAL_REGION_EXIT();
+}
+
+
+void nao_cyc_get(nao_cyc_section_t section, nao_cyc_stats_t * p_stats)
+{
+    cyc_section_t section_copy;
+
+    CRITICAL_REGION_ENTER();
+    section_copy = m_sections[section];
+    CRITICAL_REGION_EXIT();
+
+    p_stats->count = section_copy.count;
+    p_stats->min   = section_copy.min;
+    p_stats->max   = section_copy.max;
+    p_stats->mean  = (section_copy.count == 0) ? 0 : (uint32_t)(section_copy.sum / section_copy.count);
+}
+
+
+void nao_cyc_reset(void)
+{
+    CRITICAL_REGION_ENTER();
+    memset(m_sections, 0, sizeof(m_sections));
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,53 @@
+#ifndef NAO_CYC_H__
+#define NAO_CYC_H__
+
+#include <stdint.h>
+#include "nrf.h"
+
+/**@brief Code sections timed with the DWT cycle counter. */
+typedef enum
+{
+    NAO_CYC_WRITE_HANDLER,     /**< nao_write_handler(), watch write queued by the SoftDevice observer. */
+    NAO_CYC_PIPE_PACKET,       /**< One packet handled by the main loop. */
+    NAO_CYC_TX_BUFFER_PROCESS, /**< tx_buffer_process(), writes handed to the SoftDevice. */
+    NAO_CYC_NOTIF_FORWARD,     /**< ble_nao_stat_notif_forward(), notification queued for the watch. */
+    NAO_CYC_CENTRAL_EVT,       /**< on_ble_central_evt(), lamp link events. */
+    NAO_CYC_PERIPHERAL_EVT,    /**< on_ble_peripheral_evt(), watch link events. */
+    NAO_CYC_SECTION_COUNT
+} nao_cyc_section_t;
+
+/**@brief Cycle counts of one section, 64 MHz CPU cycles. */
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t mean;
+} nao_cyc_stats_t;
+
+#ifndef NAO_CYC_ENABLED
+#define NAO_CYC_ENABLED  1      /**< 0 compiles the instrumentation out. */
+#endif
+
+#if NAO_CYC_ENABLED
+/**@brief Macros for timing a section, START and STOP must be in the same scope. */
+#define NAO_CYC_START(section)  uint32_t const nao_cyc_start_##section = DWT->CYCCNT
+#define NAO_CYC_STOP(section)   nao_cyc_record((section), DWT->CYCCNT - nao_cyc_start_##section)
+#else
+#define NAO_CYC_START(section)
+#define NAO_CYC_STOP(section)
+#endif
+
+/**@brief Function for starting the DWT cycle counter. */
+void nao_cyc_init(void);
+
+/**@brief Function for adding one run of a section, called by NAO_CYC_STOP from any context. */
+void nao_cyc_record(nao_cyc_section_t section, uint32_t cycles);
+
+/**@brief Function for getting the counts of a section, min, max and mean are 0 if it never ran. */
+void nao_cyc_get(nao_cyc_section_t section, nao_cyc_stats_t * p_stats);
+
+/**@brief Function for clearing the counts of all sections. */
+void nao_cyc_reset(void);
+
+#endif // NAO_CYC_H__
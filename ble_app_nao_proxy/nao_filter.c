@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nao_filter.h"
+
+#define TELEMETRY_MSG_TYPE     0x2003
+#define TELEMETRY_LEN          20      /**< Length of a 0x2003 frame. */
+
+#define BATT_OFFSET            2       /**< Battery units, uint32 little endian. */
+#define INTENSITY_OFFSET       16      /**< Light intensity, uint16 little endian. */
+#define VOLTAGE_OFFSET         18      /**< Battery voltage in mV, uint16 little endian. */
+
+
+static nao_filter_config_t m_config;
+static nao_filter_stats_t  m_stats;
+static uint8_t             m_last[TELEMETRY_LEN];  /**< Last forwarded 0x2003 frame. */
+static bool                m_last_valid;
+static uint32_t            m_last_ms;
+
+
+static uint32_t field_get(uint8_t const * p_data, uint8_t offset, uint8_t size)
+{
+    uint32_t value = 0;
+
+    for (uint8_t i = size; i > 0; i--)
+    {
+        value = (value << 8) | p_data[offset + i - 1];
+    }
+
+    return value;
+}
+
+
+static bool field_moved(uint8_t const * p_data, uint8_t offset, uint8_t size, uint32_t deadband)
+{
+    uint32_t now  = field_get(p_data, offset, size);
+    uint32_t last = field_get(m_last, offset, size);
+    uint32_t diff = (now > last) ? (now - last) : (last - now);
+
+    return (diff > deadband) || ((deadband == 0) && (diff != 0));
+}
+
+
+void nao_filter_init(void)
+{
+    m_config.batt_deadband       = NAO_FILTER_BATT_DEADBAND;
+    m_config.voltage_deadband_mv = NAO_FILTER_VOLTAGE_DEADBAND_MV;
+    m_config.intensity_deadband  = NAO_FILTER_INTENSITY_DEADBAND;
+    m_config.heartbeat_ms        = NAO_FILTER_HEARTBEAT_MS;
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    nao_filter_reset();
+}
+
+
+void nao_filter_config_set(nao_filter_config_t const * p_config)
+{
+    m_config = *p_config;
+}
+
+
+void nao_filter_reset(void)
+{
+    m_last_valid = false;
+}
+
+
+bool nao_filter_pass(uint8_t const * p_data, uint16_t len, uint32_t now_ms)
+{
+    bool duplicate = false;
+    bool moved     = true;
+
+    if ((len != TELEMETRY_LEN) || ((uint16_t)((p_data[0] << 8) | p_data[1]) != TELEMETRY_MSG_TYPE))
+    {
+        return true;
+    }
+
+    if (m_last_valid)
+    {
+        duplicate = (memcmp(p_data, m_last, TELEMETRY_LEN) == 0);
+        moved     = !duplicate &&
+                    (field_moved(p_data, BATT_OFFSET,      4, m_config.batt_deadband)       ||
+                     field_moved(p_data, VOLTAGE_OFFSET,   2, m_config.voltage_deadband_mv) ||
+                     field_moved(p_data, INTENSITY_OFFSET, 2, m_config.intensity_deadband));
+    }
+
+    if (!moved)
+    {
+        if ((m_config.heartbeat_ms == 0) || ((now_ms - m_last_ms) < m_config.heartbeat_ms))
+        {
+            if (duplicate)
+            {
+                m_stats.duplicates++;
+            }
+            else
+            {
+                m_stats.deadband_drops++;
+            }
+            return false;
+        }
+
+        m_stats.heartbeats++;
+    }
+
+    memcpy(m_last, p_data, TELEMETRY_LEN);
+    m_last_valid = true;
+    m_last_ms    = now_ms;
+    m_stats.forwarded++;
+
+    return true;
+}
+
+
+void nao_filter_stats_get(nao_filter_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
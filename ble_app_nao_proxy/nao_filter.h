@@ -0,0 +1,64 @@
+#ifndef NAO_FILTER_H__
+#define NAO_FILTER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NAO_FILTER_BATT_UNITS_PER_PERCENT  936503  /**< 0x2003 battery units in one percent, as used by the watch. */
+
+#ifndef NAO_FILTER_BATT_DEADBAND
+#define NAO_FILTER_BATT_DEADBAND           NAO_FILTER_BATT_UNITS_PER_PERCENT  /**< Battery change (units) below which a 0x2003 frame is not forwarded. */
+#endif
+
+#ifndef NAO_FILTER_VOLTAGE_DEADBAND_MV
+#define NAO_FILTER_VOLTAGE_DEADBAND_MV     20      /**< Battery voltage change (mV) below which a 0x2003 frame is not forwarded. */
+#endif
+
+#ifndef NAO_FILTER_INTENSITY_DEADBAND
+#define NAO_FILTER_INTENSITY_DEADBAND      0       /**< Light intensity change below which a 0x2003 frame is not forwarded, 0 forwards every change. */
+#endif
+
+#ifndef NAO_FILTER_HEARTBEAT_MS
+#define NAO_FILTER_HEARTBEAT_MS            5000    /**< Longest time without a forwarded 0x2003 frame. Must stay below the watch's 10 s data timeout. */
+#endif
+
+/**@brief 0x2003 telemetry filter settings. */
+typedef struct
+{
+    uint32_t batt_deadband;          /**< Battery units. */
+    uint16_t voltage_deadband_mv;
+    uint16_t intensity_deadband;
+    uint32_t heartbeat_ms;           /**< 0 disables the heartbeat, unchanged frames are then never forwarded. */
+} nao_filter_config_t;
+
+/**@brief 0x2003 telemetry filter statistics. */
+typedef struct
+{
+    uint32_t forwarded;
+    uint32_t heartbeats;             /**< Frames forwarded only because the heartbeat interval expired. */
+    uint32_t duplicates;             /**< Byte-identical frames dropped. */
+    uint32_t deadband_drops;         /**< Frames dropped because no field moved outside its deadband. */
+} nao_filter_stats_t;
+
+/**@brief Function for initializing the filter with the compile-time defaults. */
+void nao_filter_init(void);
+
+/**@brief Function for changing the filter settings at runtime. */
+void nao_filter_config_set(nao_filter_config_t const * p_config);
+
+/**@brief Function for forgetting the last forwarded frame, so the next one always passes. */
+void nao_filter_reset(void);
+
+/**@brief Function for deciding whether a message from service 0x68 is forwarded to the watch.
+ *
+ * @details Only 0x2003 frames are filtered, they are compared field by field with the last
+ *          forwarded frame. Bytes the watch does not decode are ignored. All other messages pass.
+ *
+ * @return true if the message should be forwarded.
+ */
+bool nao_filter_pass(uint8_t const * p_data, uint16_t len, uint32_t now_ms);
+
+/**@brief Function for reading the filter statistics. */
+void nao_filter_stats_get(nao_filter_stats_t * p_stats);
+
+#endif // NAO_FILTER_H__
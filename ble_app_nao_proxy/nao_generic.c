@@ -1,20 +1,38 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include "sdk_common.h"
 #include "ble.h"
 #include "ble_gattc.h"
 #include "ble_srv_common.h"
 #include "app_error.h"
+#include "app_util_platform.h"
 #include "ble_db_discovery.h"
 #include "ble_gatt.h"
+#include "nrf_balloc.h"
+#include "nrf_sdh_ble.h"
 #include "nao_service_13.h"
 #include "nao_generic.h"
+#include "nao_cyc.h"
+
+#define NRF_LOG_MODULE_NAME nao_generic
+#if NAO_GENERIC_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       NAO_GENERIC_CONFIG_LOG_LEVEL
+#define NRF_LOG_INFO_COLOR  NAO_GENERIC_CONFIG_INFO_COLOR
+#define NRF_LOG_DEBUG_COLOR NAO_GENERIC_CONFIG_DEBUG_COLOR
+#else // NAO_GENERIC_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       0
+#endif // NAO_GENERIC_CONFIG_LOG_ENABLED
 #include "nrf_log.h"
+NRF_LOG_MODULE_REGISTER();
 
 #define TX_BUFFER_SIZE         (TX_BUFFER_MASK + 1)  /**< Size of send buffer, which is 1 higher than the mask. */
 
 #define WRITE_MESSAGE_LENGTH   BLE_CCCD_VALUE_LEN    /**< Length of the write message for CCCD. */
 #define WRITE_MESSAGE_LENGTH   BLE_CCCD_VALUE_LEN    /**< Length of the write message for CCCD. */
 
+#define TX_PACKET_POOL_SIZE    (TX_BUFFER_SIZE * NRF_SDH_BLE_CENTRAL_LINK_COUNT)  /**< Number of packet buffers. Every queued or in-flight characteristic write holds exactly one. */
+
 typedef enum
 {
     READ_REQ,  /**< Type identifying that this tx_message is a read request. */
@@ -33,8 +51,8 @@ typedef struct
  */
 typedef struct
 {
-    uint16_t     conn_handle;  /**< Connection handle to be used when transmitting this message. */
     tx_request_t type;         /**< Type of this message, i.e. read or write message. */
+    uint8_t    * p_packet;     /**< Pool buffer owning the value of a characteristic write, NULL for CCCD writes and reads. Released on TX complete. */
     union
     {
         uint16_t       read_handle;  /**< Read request message. */
@@ -43,75 +61,384 @@ typedef struct
 } tx_message_t;
 
 
-static tx_message_t  m_tx_buffer[TX_BUFFER_SIZE];  /**< Transmit buffer for messages to be transmitted to the central. */
-static uint32_t      m_tx_insert_index = 0;        /**< Current index in the transmit buffer where the next message should be inserted. */
+/**@brief Transmit queue of one link to NAO+. Each central link has its own, so writes to independent
+ *        links are pipelined in parallel and a stalled link does not hold up the others.
+ */
+typedef struct
+{
+    uint16_t     conn_handle;               /**< Link served by this queue, BLE_CONN_HANDLE_INVALID if the queue is free. */
+    tx_message_t buffer[TX_BUFFER_SIZE];    /**< Transmit buffer for messages to be transmitted to the peer. */
+    uint32_t     index;                     /**< Free-running index of the oldest unsent message, masked with TX_BUFFER_MASK on access. */
+    uint32_t     insert_index;              /**< Free-running index of the next free slot. */
+    uint32_t     done_index;                /**< Free-running index of the oldest message which was sent, but whose packet buffer was not yet released. */
+    bool         wait_rsp;                  /**< A write request is on air; nothing else is sent on this link until its BLE_GATTC_EVT_WRITE_RSP arrives. */
+} tx_queue_t;
 
 
+NRF_BALLOC_DEF(m_tx_packet_pool, TX_PACKET_SIZE, TX_PACKET_POOL_SIZE);  /**< Packet buffers for queued characteristic writes, shared by all links. */
 
-void tx_buffer_process(void)
+static tx_queue_t    m_tx_queues[NRF_SDH_BLE_CENTRAL_LINK_COUNT];  /**< One transmit queue per central link. */
+static uint32_t      m_tx_overflow_count = 0;      /**< Number of messages rejected because the transmit buffer was full. */
+static uint32_t      m_tx_alloc_fail_count = 0;    /**< Number of writes rejected because the packet pool was empty. */
+static uint32_t      m_tx_retry_count = 0;         /**< Number of sends turned down by the SoftDevice for lack of resources. */
+
+/**@brief Consumer of one attribute handle on one link. */
+typedef struct
+{
+    uint16_t                conn_handle;  /**< BLE_CONN_HANDLE_INVALID if the entry is free. */
+    uint16_t                attr_handle;
+    nao_gattc_evt_handler_t handler;
+    void                  * p_context;
+} gattc_dispatch_entry_t;
+
+static gattc_dispatch_entry_t m_dispatch[NAO_GATTC_DISPATCH_SIZE];
+
+static nao_generic_write_observer_t m_write_observer;  /**< Told about each characteristic write accepted by the SoftDevice. */
+
+
+/**@brief Function for finding the transmit queue of a link.
+ *
+ * @param[in] conn_handle  Link to look up.
+ * @param[in] assign       If the link has no queue yet, assign a free one to it.
+ *
+ * @return Queue of the link, or NULL if there is none.
+ */
+static tx_queue_t * tx_queue_get(uint16_t conn_handle, bool assign)
 {
-    if (m_tx_index != m_tx_insert_index)
+    tx_queue_t * p_free = NULL;
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
     {
-        uint32_t err_code;
+        return NULL;
+    }
 
-        if (m_tx_buffer[m_tx_index].type == READ_REQ)
+    for (uint32_t i = 0; i < NRF_SDH_BLE_CENTRAL_LINK_COUNT; i++)
+    {
+        if (m_tx_queues[i].conn_handle == conn_handle)
+        {
+            return &m_tx_queues[i];
+        }
+        if ((p_free == NULL) && (m_tx_queues[i].conn_handle == BLE_CONN_HANDLE_INVALID))
         {
-            err_code = sd_ble_gattc_read(m_tx_buffer[m_tx_index].conn_handle,
-                                         m_tx_buffer[m_tx_index].req.read_handle,
+            p_free = &m_tx_queues[i];
+        }
+    }
+
+    if (!assign || (p_free == NULL))
+    {
+        return NULL;
+    }
+
+    memset(p_free, 0, sizeof(tx_queue_t));
+    p_free->conn_handle = conn_handle;
+    return p_free;
+}
+
+
+/**@brief Function for reserving the next free slot in the transmit queue of a link.
+ *
+ * @details The slot is only committed by incrementing insert_index after it has been filled.
+ *          Messages which are unsent or still in flight are never overwritten - when all slots
+ *          are taken NULL is returned.
+ */
+static tx_message_t * tx_buffer_slot_get(tx_queue_t * p_queue)
+{
+    if ((p_queue->insert_index - p_queue->done_index) >= TX_BUFFER_SIZE)
+    {
+        m_tx_overflow_count++;
+        NRF_LOG_INFO("tx_buffer: buffer full on conn_handle 0x%x, message rejected (overflows: %d)\r\n",
+                     p_queue->conn_handle, m_tx_overflow_count);
+        return NULL;
+    }
+
+    return &p_queue->buffer[p_queue->insert_index & TX_BUFFER_MASK];
+}
+
+
+/**@brief Function for returning the packet buffer of a message to the pool.
+ */
+static void tx_packet_release(tx_message_t * p_msg)
+{
+    if (p_msg->p_packet != NULL)
+    {
+        nrf_balloc_free(&m_tx_packet_pool, p_msg->p_packet);
+        p_msg->p_packet = NULL;
+    }
+}
+
+
+/**@brief Function for retiring sent messages whose packet buffers have been released.
+ */
+static void tx_buffer_retire(tx_queue_t * p_queue)
+{
+    while ((p_queue->done_index != p_queue->index) &&
+           (p_queue->buffer[p_queue->done_index & TX_BUFFER_MASK].p_packet == NULL))
+    {
+        p_queue->done_index++;
+    }
+}
+
+
+/**@brief Function for releasing packet buffers of write commands the SoftDevice has transmitted.
+ *
+ * @param[in] p_queue  Queue of the link on which the write commands were transmitted.
+ * @param[in] count    Number of write commands transmitted, oldest first.
+ */
+static void tx_buffer_tx_complete(tx_queue_t * p_queue, uint8_t count)
+{
+    for (uint32_t i = p_queue->done_index; (i != p_queue->index) && (count > 0); i++)
+    {
+        tx_message_t * p_msg = &p_queue->buffer[i & TX_BUFFER_MASK];
+
+        if (p_msg->p_packet != NULL)
+        {
+            tx_packet_release(p_msg);
+            count--;
+        }
+    }
+
+    tx_buffer_retire(p_queue);
+}
+
+
+/**@brief Function for dropping all messages of a link which went down and freeing its queue.
+ */
+static void tx_buffer_flush(tx_queue_t * p_queue)
+{
+    for (uint32_t i = p_queue->done_index; i != p_queue->insert_index; i++)
+    {
+        tx_packet_release(&p_queue->buffer[i & TX_BUFFER_MASK]);
+    }
+
+    p_queue->index        = 0;
+    p_queue->insert_index = 0;
+    p_queue->done_index   = 0;
+    p_queue->wait_rsp     = false;
+    p_queue->conn_handle  = BLE_CONN_HANDLE_INVALID;
+}
+
+
+/**@brief Function for sending queued messages of one link to the SoftDevice.
+ *
+ * @details Sends as many messages as the SoftDevice accepts. When it runs out of resources the
+ *          remaining messages stay queued and are sent from the next TX complete or write response
+ *          event on this link (see @ref nao_generic_on_ble_evt). Only read and write requests wait
+ *          for the response to the previous request, write commands are pipelined behind it.
+ */
+static void tx_queue_process(tx_queue_t * p_queue)
+{
+    while (p_queue->index != p_queue->insert_index)
+    {
+        uint32_t       err_code;
+        tx_message_t * p_msg      = &p_queue->buffer[p_queue->index & TX_BUFFER_MASK];
+        bool           is_request = (p_msg->type == READ_REQ) ||
+                                    (p_msg->req.write_req.gattc_params.write_op == BLE_GATT_OP_WRITE_REQ);
+
+        // ATT allows one outstanding request per link, write commands may follow it right away.
+        if (is_request && p_queue->wait_rsp)
+        {
+            break;
+        }
+
+        if (p_msg->type == READ_REQ)
+        {
+            err_code = sd_ble_gattc_read(p_queue->conn_handle,
+                                         p_msg->req.read_handle,
                                          0);
         }
         else
         {
-            err_code = sd_ble_gattc_write(m_tx_buffer[m_tx_index].conn_handle,
-                                          &m_tx_buffer[m_tx_index].req.write_req.gattc_params);
+            err_code = sd_ble_gattc_write(p_queue->conn_handle,
+                                          &p_msg->req.write_req.gattc_params);
         }
 
         if (err_code == NRF_SUCCESS)
         {
             NRF_LOG_DEBUG("tx_buffer_process: SD Read/Write API returns Success..\r\n");
-            m_tx_index++;
-            m_tx_index &= TX_BUFFER_MASK;
+
+            if ((m_write_observer != NULL) && (p_msg->p_packet != NULL))
+            {
+                m_write_observer(p_queue->conn_handle,
+                                 p_msg->req.write_req.gattc_params.handle,
+                                 p_msg->req.write_req.gattc_params.p_value,
+                                 p_msg->req.write_req.gattc_params.len);
+            }
+
+            if (is_request)
+            {
+                p_queue->wait_rsp = true;
+            }
+            p_queue->index++;
         }
-        else
+        else if ((err_code == NRF_ERROR_RESOURCES) || (err_code == NRF_ERROR_BUSY))
         {
             NRF_LOG_DEBUG("tx_buffer_process: SD Read/Write API returns error. This message sending will be "
-                "attempted again..\r\n");
+                "attempted again on TX complete..\r\n");
+            m_tx_retry_count++;
+            break;
         }
+        else
+        {
+            NRF_LOG_INFO("tx_buffer_process: SD Read/Write API returns error %d, message dropped\r\n", err_code);
+            tx_packet_release(p_msg);
+            p_queue->index++;
+        }
+    }
+
+    tx_buffer_retire(p_queue);
+}
 
 
+void tx_buffer_process(void)
+{
+    NAO_CYC_START(NAO_CYC_TX_BUFFER_PROCESS);
+
+    CRITICAL_REGION_ENTER();
+    for (uint32_t i = 0; i < NRF_SDH_BLE_CENTRAL_LINK_COUNT; i++)
+    {
+        if (m_tx_queues[i].conn_handle != BLE_CONN_HANDLE_INVALID)
+        {
+            tx_queue_process(&m_tx_queues[i]);
+        }
     }
+    CRITICAL_REGION_EXIT();
+
+    NAO_CYC_STOP(NAO_CYC_TX_BUFFER_PROCESS);
+}
+
+
+void nao_generic_write_observer_set(nao_generic_write_observer_t observer)
+{
+    m_write_observer = observer;
+}
+
+
+uint32_t tx_buffer_init(void)
+{
+    for (uint32_t i = 0; i < NRF_SDH_BLE_CENTRAL_LINK_COUNT; i++)
+    {
+        m_tx_queues[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+
+    return nrf_balloc_init(&m_tx_packet_pool);
+}
+
+
+void nao_generic_on_ble_evt(ble_evt_t const * p_ble_evt)
+{
+    tx_queue_t * p_queue = tx_queue_get(p_ble_evt->evt.gattc_evt.conn_handle, false);
+
+    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        nao_gattc_dispatch_clear(p_ble_evt->evt.gap_evt.conn_handle);
+    }
+
+    if (p_queue == NULL)
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GATTC_EVT_WRITE_RSP:
+        case BLE_GATTC_EVT_READ_RSP:
+            p_queue->wait_rsp = false;
+            tx_queue_process(p_queue);
+            break;
+
+        case BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE:
+            tx_buffer_tx_complete(p_queue, p_ble_evt->evt.gattc_evt.params.write_cmd_tx_complete.count);
+            tx_queue_process(p_queue);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            tx_buffer_flush(p_queue);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void tx_buffer_stats_get(tx_buffer_stats_t * p_stats)
+{
+    p_stats->queue_overflows     = m_tx_overflow_count;
+    p_stats->pool_alloc_failures = m_tx_alloc_fail_count;
+    p_stats->retries             = m_tx_retry_count;
+    p_stats->pool_in_use         = nrf_balloc_utilization_get(&m_tx_packet_pool);
+    p_stats->pool_high_water     = nrf_balloc_max_utilization_get(&m_tx_packet_pool);
+}
+
+
+void tx_buffer_stats_reset(void)
+{
+    // The pool high water mark is kept by nrf_balloc and counts since boot.
+    CRITICAL_REGION_ENTER();
+    m_tx_overflow_count   = 0;
+    m_tx_alloc_fail_count = 0;
+    m_tx_retry_count      = 0;
+    CRITICAL_REGION_EXIT();
 }
 
 
 /**@brief Function for creating a message for writing to the CCCD.
+ *
+ * @details The transmit queues are also served from the SoftDevice observers (TX complete and
+ *          write response), callers in the main loop are kept out of them with a short critical
+ *          region. This holds for all functions that queue or send messages.
+ *
+ * @return NRF_SUCCESS if the message was queued, NRF_ERROR_NO_MEM if the transmit buffer is full
+ *         or all link queues are taken.
  */
-
 uint32_t cccd_configure(uint16_t conn_handle, uint16_t handle_cccd, bool enable)
 {
     NRF_LOG_DEBUG("Configuring CCCD. CCCD Handle = %d, Connection Handle = %d",
         handle_cccd,conn_handle);
 
-    tx_message_t * p_msg;
+    tx_queue_t   * p_queue;
+    tx_message_t * p_msg    = NULL;
     uint16_t       cccd_val = enable ? BLE_GATT_HVX_NOTIFICATION : 0;
 
-    p_msg              = &m_tx_buffer[m_tx_insert_index++];
-    m_tx_insert_index &= TX_BUFFER_MASK;
+    CRITICAL_REGION_ENTER();
 
-    p_msg->req.write_req.gattc_params.handle   = handle_cccd;
-    p_msg->req.write_req.gattc_params.len      = WRITE_MESSAGE_LENGTH;
-    p_msg->req.write_req.gattc_params.p_value  = p_msg->req.write_req.gattc_value;
-    p_msg->req.write_req.gattc_params.offset   = 0;
-    p_msg->req.write_req.gattc_params.write_op = BLE_GATT_OP_WRITE_REQ;
-    p_msg->req.write_req.gattc_value[0]        = LSB_16(cccd_val);
-    p_msg->req.write_req.gattc_value[1]        = MSB_16(cccd_val);
-    p_msg->conn_handle                         = conn_handle;
-    p_msg->type                                = WRITE_REQ;
+    p_queue = tx_queue_get(conn_handle, true);
+    if (p_queue != NULL)
+    {
+        p_msg = tx_buffer_slot_get(p_queue);
+    }
 
-    tx_buffer_process();
-    return NRF_SUCCESS;
+    if (p_msg != NULL)
+    {
+        p_msg->req.write_req.gattc_params.handle   = handle_cccd;
+        p_msg->req.write_req.gattc_params.len      = WRITE_MESSAGE_LENGTH;
+        p_msg->req.write_req.gattc_params.p_value  = p_msg->req.write_req.gattc_value;
+        p_msg->req.write_req.gattc_params.offset   = 0;
+        p_msg->req.write_req.gattc_params.write_op = BLE_GATT_OP_WRITE_REQ;
+        p_msg->req.write_req.gattc_value[0]        = LSB_16(cccd_val);
+        p_msg->req.write_req.gattc_value[1]        = MSB_16(cccd_val);
+        p_msg->type                                = WRITE_REQ;
+        p_msg->p_packet                            = NULL;
+
+        p_queue->insert_index++;
+
+        tx_queue_process(p_queue);
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return (p_msg != NULL) ? NRF_SUCCESS : NRF_ERROR_NO_MEM;
 }
 
 
+/**@brief Function for queueing a write command to a NAO+ characteristic.
+ *
+ * @details The value is copied once into a buffer from the packet pool, so the caller's buffer
+ *          (usually the data of a BLE event) does not have to outlive this call.
+ *
+ * @return NRF_SUCCESS if the message was queued, NRF_ERROR_NO_MEM if the transmit buffer or the
+ *         packet pool is full or all link queues are taken, NRF_ERROR_INVALID_LENGTH if the value does not fit a packet buffer.
+ */
 uint32_t ble_nao_characteristic_write(uint16_t conn_handle, uint16_t char_tx_handle, uint8_t const *buffer, uint16_t buffer_len)
 {
 
@@ -120,24 +447,143 @@ uint32_t ble_nao_characteristic_write(uint16_t conn_handle, uint16_t char_tx_han
         return NRF_ERROR_INVALID_STATE;
     }
 
+    if (buffer_len > TX_PACKET_SIZE)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
     NRF_LOG_DEBUG("writing char handle 0x%x on NAO\r\n", char_tx_handle);
 
-    tx_message_t * p_msg;
+    tx_queue_t   * p_queue;
+    tx_message_t * p_msg    = NULL;
+    uint8_t      * p_packet = NULL;
+
+    CRITICAL_REGION_ENTER();
+
+    p_queue = tx_queue_get(conn_handle, true);
+    if (p_queue != NULL)
+    {
+        p_msg = tx_buffer_slot_get(p_queue);
+    }
+
+    if (p_msg != NULL)
+    {
+        p_packet = nrf_balloc_alloc(&m_tx_packet_pool);
+        if (p_packet == NULL)
+        {
+            m_tx_alloc_fail_count++;
+            NRF_LOG_INFO("tx_buffer: packet pool empty, message rejected\r\n");
+        }
+    }
+
+    if (p_packet != NULL)
+    {
+        memcpy(p_packet, buffer, buffer_len);
+
+        p_msg->req.write_req.gattc_params.handle   = char_tx_handle;
+        p_msg->req.write_req.gattc_params.len      = buffer_len;
+        p_msg->req.write_req.gattc_params.p_value  = p_packet;
+        p_msg->req.write_req.gattc_params.offset   = 0;
+        p_msg->req.write_req.gattc_params.write_op = BLE_GATT_OP_WRITE_CMD;
+        p_msg->req.write_req.gattc_value[0]        = 0;
+        p_msg->type                                = WRITE_REQ;
+        p_msg->p_packet                            = p_packet;
+
+        p_queue->insert_index++;
+
+        tx_queue_process(p_queue);
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return (p_packet != NULL) ? NRF_SUCCESS : NRF_ERROR_NO_MEM;
+}
+
+
+/**@brief Function for finding the dispatch entry of a link and attribute handle.
+ */
+static gattc_dispatch_entry_t * dispatch_find(uint16_t conn_handle, uint16_t attr_handle)
+{
+    for (uint8_t i = 0; i < NAO_GATTC_DISPATCH_SIZE; i++)
+    {
+        if ((m_dispatch[i].handler != NULL) &&
+            (m_dispatch[i].conn_handle == conn_handle) &&
+            (m_dispatch[i].attr_handle == attr_handle))
+        {
+            return &m_dispatch[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+uint32_t nao_gattc_dispatch_register(uint16_t conn_handle, uint16_t attr_handle, nao_gattc_evt_handler_t handler, void * p_context)
+{
+    gattc_dispatch_entry_t * p_entry = dispatch_find(conn_handle, attr_handle);
+
+    for (uint8_t i = 0; (i < NAO_GATTC_DISPATCH_SIZE) && (p_entry == NULL); i++)
+    {
+        if (m_dispatch[i].handler == NULL)
+        {
+            p_entry = &m_dispatch[i];
+        }
+    }
 
-    p_msg              = &m_tx_buffer[m_tx_insert_index++];
-    m_tx_insert_index &= TX_BUFFER_MASK;
+    if (p_entry == NULL)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
 
-    p_msg->req.write_req.gattc_params.handle   = char_tx_handle;
-    p_msg->req.write_req.gattc_params.len      = buffer_len;
-    p_msg->req.write_req.gattc_params.p_value  = buffer;
-    p_msg->req.write_req.gattc_params.offset   = 0;
-    p_msg->req.write_req.gattc_params.write_op = BLE_GATT_OP_WRITE_CMD;
-    p_msg->req.write_req.gattc_value[0]        = 0;
-    p_msg->conn_handle                         = conn_handle;
-    p_msg->type                                = WRITE_REQ;
+    p_entry->conn_handle = conn_handle;
+    p_entry->attr_handle = attr_handle;
+    p_entry->p_context   = p_context;
+    p_entry->handler     = handler;
 
-    tx_buffer_process();
     return NRF_SUCCESS;
 }
 
 
+void nao_gattc_dispatch_clear(uint16_t conn_handle)
+{
+    for (uint8_t i = 0; i < NAO_GATTC_DISPATCH_SIZE; i++)
+    {
+        if (m_dispatch[i].conn_handle == conn_handle)
+        {
+            m_dispatch[i].handler = NULL;
+        }
+    }
+}
+
+
+bool nao_gattc_dispatch(ble_evt_t const * p_ble_evt)
+{
+    ble_gattc_evt_t const  * p_gattc_evt = &p_ble_evt->evt.gattc_evt;
+    gattc_dispatch_entry_t * p_entry;
+    uint16_t                 attr_handle;
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GATTC_EVT_HVX:
+            attr_handle = p_gattc_evt->params.hvx.handle;
+            break;
+
+        case BLE_GATTC_EVT_WRITE_RSP:
+            attr_handle = (p_gattc_evt->gatt_status == BLE_GATT_STATUS_SUCCESS) ? p_gattc_evt->params.write_rsp.handle
+                                                                               : p_gattc_evt->error_handle;
+            break;
+
+        default:
+            return false;
+    }
+
+    p_entry = dispatch_find(p_gattc_evt->conn_handle, attr_handle);
+    if (p_entry == NULL)
+    {
+        return false;
+    }
+
+    p_entry->handler(p_entry->p_context, p_ble_evt);
+
+    return true;
+}
@@ -1,9 +1,61 @@
+#ifndef NAO_GENERIC_H__
+#define NAO_GENERIC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+
 #define TX_BUFFER_MASK         0x07
 
-static uint32_t      m_tx_index = 0;
+#define TX_PACKET_SIZE         (BLE_GATT_ATT_MTU_DEFAULT - 3)  /**< Size of a packet buffer, the longest value a characteristic write to NAO+ can carry. */
+
+#ifndef NAO_GATTC_DISPATCH_SIZE
+#define NAO_GATTC_DISPATCH_SIZE  8     /**< Attribute handles with a registered consumer, over all NAO+ links. */
+#endif
+
+/**@brief Consumer of the GATT client events of one attribute handle. */
+typedef void (*nao_gattc_evt_handler_t)(void * p_context, ble_evt_t const * p_ble_evt);
+
+/**@brief Observer of the characteristic writes handed to the SoftDevice. */
+typedef void (*nao_generic_write_observer_t)(uint16_t conn_handle, uint16_t attr_handle, uint8_t const * p_value, uint16_t len);
 
+/**@brief NAO+ transmit buffer statistics. */
+typedef struct
+{
+    uint32_t queue_overflows;      /**< Messages rejected because the transmit buffer was full. */
+    uint32_t pool_alloc_failures;  /**< Writes rejected because no packet buffer was free. */
+    uint32_t retries;              /**< Sends the SoftDevice turned down for lack of resources, tried again later. */
+    uint8_t  pool_in_use;          /**< Packet buffers currently held by queued or in-flight writes. */
+    uint8_t  pool_high_water;      /**< Highest number of packet buffers held at the same time. */
+} tx_buffer_stats_t;
+
+uint32_t tx_buffer_init(void);
 void tx_buffer_process(void);
+void tx_buffer_stats_get(tx_buffer_stats_t * p_stats);
+void tx_buffer_stats_reset(void);
+void nao_generic_on_ble_evt(ble_evt_t const * p_ble_evt);
 uint32_t cccd_configure(uint16_t conn_handle, uint16_t cccd_handle, bool enable);
 uint32_t ble_nao_characteristic_write(uint16_t conn_handle, uint16_t char_tx_handle, uint8_t const *buffer, uint16_t buffer_len);
 
+/**@brief Function for setting the observer told about each characteristic write the SoftDevice accepted, NULL for none. */
+void nao_generic_write_observer_set(nao_generic_write_observer_t observer);
+
+/**@brief Function for routing the notifications and write responses of an attribute handle to one consumer.
+ *
+ * @details A later registration of the same link and handle replaces the earlier one. The entries of
+ *          a link are dropped when it disconnects.
+ *
+ * @return NRF_SUCCESS, or NRF_ERROR_NO_MEM if the dispatch table is full.
+ */
+uint32_t nao_gattc_dispatch_register(uint16_t conn_handle, uint16_t attr_handle, nao_gattc_evt_handler_t handler, void * p_context);
+
+/**@brief Function for dropping all dispatch entries of a link. */
+void nao_gattc_dispatch_clear(uint16_t conn_handle);
+
+/**@brief Function for passing a BLE_GATTC_EVT_HVX or BLE_GATTC_EVT_WRITE_RSP to the consumer of its handle.
+ *
+ * @return true if a consumer took the event.
+ */
+bool nao_gattc_dispatch(ble_evt_t const * p_ble_evt);
 
+#endif // NAO_GENERIC_H__
@@ -0,0 +1,184 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nao_lat.h"
+#include "app_util_platform.h"
+#include "app_timer.h"
+
+
+/**@brief A request waiting for its reply. */
+typedef struct
+{
+    bool     used;
+    bool     written;      /**< Handed to the SoftDevice, tx_ticks is valid. */
+    uint8_t  service;
+    uint16_t type;
+    uint32_t rx_ticks;
+    uint32_t tx_ticks;
+} lat_pending_t;
+
+static const uint16_t m_bucket_limits_ms[NAO_LAT_BUCKET_COUNT - 1] = {5, 10, 20, 50, 100, 200, 500};
+
+static lat_pending_t   m_pending[NAO_LAT_PENDING_SIZE];
+static nao_lat_stats_t m_stats;
+
+
+static uint32_t ticks_to_ms(uint32_t ticks)
+{
+    return (uint32_t)(((uint64_t)ticks * 1000) / APP_TIMER_CLOCK_FREQ);
+}
+
+
+static void hist_add(nao_lat_hop_t hop, uint32_t ticks)
+{
+    nao_lat_hist_t * p_hist = &m_stats.hops[hop];
+    uint32_t         ms     = ticks_to_ms(ticks);
+    uint8_t          bucket = 0;
+
+    while ((bucket < NAO_LAT_BUCKET_COUNT - 1) && (ms >= m_bucket_limits_ms[bucket]))
+    {
+        bucket++;
+    }
+
+    if (p_hist->buckets[bucket] < UINT16_MAX)
+    {
+        p_hist->buckets[bucket]++;
+    }
+    if (ms > p_hist->max_ms)
+    {
+        p_hist->max_ms = (ms < UINT16_MAX) ? ms : UINT16_MAX;
+    }
+}
+
+
+/**@brief Function for finding the request traced for a service and message type. */
+static lat_pending_t * pending_find(uint8_t service, uint16_t type)
+{
+    for (uint8_t i = 0; i < NAO_LAT_PENDING_SIZE; i++)
+    {
+        if (m_pending[i].used && (m_pending[i].service == service) && (m_pending[i].type == type))
+        {
+            return &m_pending[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**@brief Function for dropping the requests which will not get a reply any more.
+ *
+ * @details Called on every traced packet, a late reply must not end up in the histograms.
+ */
+static void pending_expire(uint32_t now)
+{
+    for (uint8_t i = 0; i < NAO_LAT_PENDING_SIZE; i++)
+    {
+        if (m_pending[i].used &&
+            (ticks_to_ms(app_timer_cnt_diff_compute(now, m_pending[i].rx_ticks)) >= NAO_LAT_TIMEOUT_MS))
+        {
+            m_pending[i].used = false;
+            m_stats.timeouts++;
+        }
+    }
+}
+
+
+void nao_lat_watch_rx(uint8_t service, uint16_t type)
+{
+    uint32_t        now = app_timer_cnt_get();
+    lat_pending_t * p_pending;
+
+    CRITICAL_REGION_ENTER();
+
+    pending_expire(now);
+
+    if (pending_find(service, type) == NULL)
+    {
+        p_pending = NULL;
+        for (uint8_t i = 0; i < NAO_LAT_PENDING_SIZE; i++)
+        {
+            if (!m_pending[i].used)
+            {
+                p_pending = &m_pending[i];
+                break;
+            }
+        }
+
+        if (p_pending == NULL)
+        {
+            m_stats.overflows++;
+        }
+        else
+        {
+            p_pending->used     = true;
+            p_pending->written  = false;
+            p_pending->service  = service;
+            p_pending->type     = type;
+            p_pending->rx_ticks = now;
+        }
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+
+void nao_lat_lamp_tx(uint8_t service, uint16_t type)
+{
+    uint32_t        now = app_timer_cnt_get();
+    lat_pending_t * p_pending;
+
+    CRITICAL_REGION_ENTER();
+
+    pending_expire(now);
+
+    p_pending = pending_find(service, type);
+    if ((p_pending != NULL) && !p_pending->written)
+    {
+        p_pending->written  = true;
+        p_pending->tx_ticks = now;
+        hist_add(NAO_LAT_HOP_PROXY, app_timer_cnt_diff_compute(now, p_pending->rx_ticks));
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+
+void nao_lat_watch_tx(uint8_t service, uint16_t type)
+{
+    uint32_t        now = app_timer_cnt_get();
+    lat_pending_t * p_pending;
+
+    CRITICAL_REGION_ENTER();
+
+    pending_expire(now);
+
+    p_pending = pending_find(service, type);
+    if (p_pending != NULL)
+    {
+        // A reply served from the cache never went to the lamp, it only counts for the total.
+        if (p_pending->written)
+        {
+            hist_add(NAO_LAT_HOP_LAMP, app_timer_cnt_diff_compute(now, p_pending->tx_ticks));
+        }
+        hist_add(NAO_LAT_HOP_TOTAL, app_timer_cnt_diff_compute(now, p_pending->rx_ticks));
+        p_pending->used = false;
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+
+nao_lat_stats_t const * nao_lat_stats_get(void)
+{
+    return &m_stats;
+}
+
+
+void nao_lat_reset(void)
+{
+    CRITICAL_REGION_ENTER();
+    memset(m_pending, 0, sizeof(m_pending));
+    memset(&m_stats, 0, sizeof(m_stats));
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,57 @@
+#ifndef NAO_LAT_H__
+#define NAO_LAT_H__
+
+#include <stdint.h>
+
+/**@brief Hops of a watch request answered by the lamp. */
+typedef enum
+{
+    NAO_LAT_HOP_PROXY,     /**< Watch write received to lamp write handed to the SoftDevice. */
+    NAO_LAT_HOP_LAMP,      /**< Lamp write handed to the SoftDevice to the reply sent to the watch. */
+    NAO_LAT_HOP_TOTAL,     /**< Watch write received to the reply sent to the watch. */
+    NAO_LAT_HOP_COUNT
+} nao_lat_hop_t;
+
+#define NAO_LAT_BUCKET_COUNT  8     /**< Upper bounds 5, 10, 20, 50, 100, 200, 500 ms, the last bucket is open. */
+
+/**@brief Latency histogram of one hop. */
+typedef struct
+{
+    uint16_t buckets[NAO_LAT_BUCKET_COUNT];    /**< Samples per bucket, saturating. */
+    uint16_t max_ms;                           /**< Longest sample, saturating. */
+} nao_lat_hist_t;
+
+/**@brief Latency metrics. */
+typedef struct
+{
+    nao_lat_hist_t hops[NAO_LAT_HOP_COUNT];
+    uint32_t       timeouts;       /**< Requests which got no reply within NAO_LAT_TIMEOUT_MS. */
+    uint32_t       overflows;      /**< Requests not traced because all slots were taken. */
+} nao_lat_stats_t;
+
+#ifndef NAO_LAT_PENDING_SIZE
+#define NAO_LAT_PENDING_SIZE  8         /**< Requests traced at the same time. */
+#endif
+
+#ifndef NAO_LAT_TIMEOUT_MS
+#define NAO_LAT_TIMEOUT_MS    2000      /**< A request without a reply after this long is dropped. */
+#endif
+
+/**@brief Function for time stamping a request from the watch. Requests and replies are matched by
+ *        NAO+ service and message type, a request already traced for the same pair is not traced again.
+ */
+void nao_lat_watch_rx(uint8_t service, uint16_t type);
+
+/**@brief Function for time stamping a request handed to the SoftDevice for the lamp. */
+void nao_lat_lamp_tx(uint8_t service, uint16_t type);
+
+/**@brief Function for time stamping a reply forwarded to the watch, which ends the trace. */
+void nao_lat_watch_tx(uint8_t service, uint16_t type);
+
+/**@brief Function for getting the latency metrics. */
+nao_lat_stats_t const * nao_lat_stats_get(void);
+
+/**@brief Function for clearing the histograms and the requests being traced. */
+void nao_lat_reset(void);
+
+#endif // NAO_LAT_H__
@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nao_phy.h"
+#include "nrf_log.h"
+
+
+static nao_phy_link_stats_t m_stats[NAO_CONN_LINK_COUNT];
+static uint32_t             m_since_ms[NAO_CONN_LINK_COUNT];   /**< Start of the current TX PHY stretch. */
+static bool                 m_connected[NAO_CONN_LINK_COUNT];
+static uint8_t              m_requested[NAO_CONN_LINK_COUNT];  /**< PHY of a pending update, BLE_GAP_PHY_AUTO if none. */
+static uint8_t              m_refused[NAO_CONN_LINK_COUNT];    /**< PHYs the peer did not take, as BLE_GAP_PHY_* mask. */
+
+
+static nao_phy_t phy_index(uint8_t phy)
+{
+    switch (phy)
+    {
+        case BLE_GAP_PHY_2MBPS:
+            return NAO_PHY_2M;
+
+        case BLE_GAP_PHY_CODED:
+            return NAO_PHY_CODED;
+
+        default:
+            return NAO_PHY_1M;
+    }
+}
+
+
+static void time_account(nao_conn_link_t link, uint32_t now_ms)
+{
+    m_stats[link].time_ms[phy_index(m_stats[link].tx_phy)] += now_ms - m_since_ms[link];
+    m_since_ms[link] = now_ms;
+}
+
+
+uint8_t nao_phy_connected(nao_conn_link_t link, uint32_t now_ms)
+{
+    memset(&m_stats[link], 0, sizeof(m_stats[link]));
+    m_stats[link].tx_phy = BLE_GAP_PHY_1MBPS;
+    m_stats[link].rx_phy = BLE_GAP_PHY_1MBPS;
+
+    m_since_ms[link]  = now_ms;
+    m_connected[link] = true;
+    m_requested[link] = BLE_GAP_PHY_AUTO;
+    m_refused[link]   = 0;
+
+    return BLE_GAP_PHY_2MBPS;
+}
+
+
+void nao_phy_disconnected(nao_conn_link_t link, uint32_t now_ms)
+{
+    if (!m_connected[link])
+    {
+        return;
+    }
+
+    time_account(link, now_ms);
+    m_connected[link] = false;
+
+    NRF_LOG_INFO("link %d PHY time: 1M %d ms, 2M %d ms, coded %d ms", link,
+                 m_stats[link].time_ms[NAO_PHY_1M],
+                 m_stats[link].time_ms[NAO_PHY_2M],
+                 m_stats[link].time_ms[NAO_PHY_CODED]);
+}
+
+
+uint8_t nao_phy_rssi_update(nao_conn_link_t link, int8_t rssi)
+{
+    uint8_t target;
+
+    m_stats[link].rssi = rssi;
+
+    // Only the lamp link drops to Coded PHY, the watch is worn next to the proxy.
+    if ((link != NAO_CONN_LINK_LAMP) || (m_requested[link] != BLE_GAP_PHY_AUTO))
+    {
+        return BLE_GAP_PHY_AUTO;
+    }
+
+    if (m_stats[link].tx_phy == BLE_GAP_PHY_CODED)
+    {
+        if (rssi <= NAO_PHY_2M_RSSI_DBM)
+        {
+            return BLE_GAP_PHY_AUTO;
+        }
+        target = (m_refused[link] & BLE_GAP_PHY_2MBPS) ? BLE_GAP_PHY_1MBPS : BLE_GAP_PHY_2MBPS;
+    }
+    else
+    {
+        if (rssi >= NAO_PHY_CODED_RSSI_DBM)
+        {
+            return BLE_GAP_PHY_AUTO;
+        }
+        target = BLE_GAP_PHY_CODED;
+    }
+
+    if (m_refused[link] & target)
+    {
+        return BLE_GAP_PHY_AUTO;
+    }
+
+    NRF_LOG_INFO("link %d RSSI %d dBm, requesting PHY %d", link, rssi, target);
+
+    return target;
+}
+
+
+void nao_phy_request_sent(nao_conn_link_t link, uint8_t phy)
+{
+    m_requested[link] = phy;
+}
+
+
+void nao_phy_updated(nao_conn_link_t link, uint8_t status, uint8_t tx_phy, uint8_t rx_phy, uint32_t now_ms)
+{
+    if (!m_connected[link])
+    {
+        return;
+    }
+
+    if (status == BLE_HCI_STATUS_CODE_SUCCESS)
+    {
+        time_account(link, now_ms);
+
+        if (tx_phy != m_stats[link].tx_phy)
+        {
+            m_stats[link].changes++;
+            NRF_LOG_INFO("link %d PHY %d -> %d", link, m_stats[link].tx_phy, tx_phy);
+        }
+
+        m_stats[link].tx_phy = tx_phy;
+        m_stats[link].rx_phy = rx_phy;
+    }
+
+    if ((m_requested[link] != BLE_GAP_PHY_AUTO) &&
+        ((status != BLE_HCI_STATUS_CODE_SUCCESS) || (tx_phy != m_requested[link])))
+    {
+        NRF_LOG_INFO("link %d peer did not take PHY %d (status 0x%x)", link, m_requested[link], status);
+        m_refused[link] |= m_requested[link];
+    }
+
+    m_requested[link] = BLE_GAP_PHY_AUTO;
+}
+
+
+nao_phy_link_stats_t const * nao_phy_stats_get(nao_conn_link_t link, uint32_t now_ms)
+{
+    if (m_connected[link])
+    {
+        time_account(link, now_ms);
+    }
+
+    return &m_stats[link];
+}
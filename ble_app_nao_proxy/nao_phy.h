@@ -0,0 +1,63 @@
+#ifndef NAO_PHY_H__
+#define NAO_PHY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+#include "nao_conn_policy.h"
+
+/**@brief PHYs time is accounted for. */
+typedef enum
+{
+    NAO_PHY_1M,
+    NAO_PHY_2M,
+    NAO_PHY_CODED,
+    NAO_PHY_COUNT
+} nao_phy_t;
+
+/**@brief PHY metrics of one link. */
+typedef struct
+{
+    uint32_t time_ms[NAO_PHY_COUNT];  /**< Time spent on each TX PHY, the current stretch included. */
+    uint16_t changes;                 /**< PHY updates which changed the TX PHY. */
+    uint8_t  tx_phy;                  /**< Current BLE_GAP_PHY_* in each direction. */
+    uint8_t  rx_phy;
+    int8_t   rssi;                    /**< Last reported RSSI in dBm, lamp link only. */
+} nao_phy_link_stats_t;
+
+#ifndef NAO_PHY_CODED_RSSI_DBM
+#define NAO_PHY_CODED_RSSI_DBM  -85     /**< Lamp link moves to Coded PHY below this RSSI. */
+#endif
+
+#ifndef NAO_PHY_2M_RSSI_DBM
+#define NAO_PHY_2M_RSSI_DBM     -75     /**< Lamp link returns from Coded PHY above this RSSI. */
+#endif
+
+#define NAO_PHY_RSSI_THRESHOLD_DB  2    /**< RSSI change reported by the SoftDevice. */
+#define NAO_PHY_RSSI_SKIP_COUNT    10   /**< Samples the RSSI change must persist before it is reported. */
+
+/**@brief Function for starting the PHY bookkeeping of a new link.
+ *
+ * @return PHY to request on the link, BLE_GAP_PHY_2MBPS.
+ */
+uint8_t nao_phy_connected(nao_conn_link_t link, uint32_t now_ms);
+
+/**@brief Function for closing the PHY bookkeeping of a disconnected link. */
+void nao_phy_disconnected(nao_conn_link_t link, uint32_t now_ms);
+
+/**@brief Function for noting a new RSSI of a link.
+ *
+ * @return PHY to request on the link, or BLE_GAP_PHY_AUTO if the current one is fine.
+ */
+uint8_t nao_phy_rssi_update(nao_conn_link_t link, int8_t rssi);
+
+/**@brief Function for noting a PHY update the proxy requested, a refusal rules that PHY out for the link. */
+void nao_phy_request_sent(nao_conn_link_t link, uint8_t phy);
+
+/**@brief Function for noting the result of a PHY update procedure. */
+void nao_phy_updated(nao_conn_link_t link, uint8_t status, uint8_t tx_phy, uint8_t rx_phy, uint32_t now_ms);
+
+/**@brief Function for getting the PHY metrics of a link, up to date at now_ms. */
+nao_phy_link_stats_t const * nao_phy_stats_get(nao_conn_link_t link, uint32_t now_ms);
+
+#endif // NAO_PHY_H__
@@ -0,0 +1,169 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nao_pipe.h"
+#include "nao_cyc.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+#include "app_timer.h"
+#include "nrf_error.h"
+
+/**@brief One queued packet. */
+typedef struct
+{
+    uint32_t put_ticks;
+    uint16_t len;
+    uint8_t  src;
+    uint8_t  data[NAO_PIPE_DATA_MAX];
+} pipe_item_t;
+
+/**@brief Ring of packets. head is advanced by nao_pipe_put(), tail by nao_pipe_execute(). */
+typedef struct
+{
+    pipe_item_t *    p_items;
+    uint8_t          size;
+    volatile uint8_t head;
+    volatile uint8_t tail;
+} pipe_queue_t;
+
+STATIC_ASSERT((NAO_PIPE_HIGH_SIZE & (NAO_PIPE_HIGH_SIZE - 1)) == 0);
+STATIC_ASSERT((NAO_PIPE_LOW_SIZE & (NAO_PIPE_LOW_SIZE - 1)) == 0);
+STATIC_ASSERT(NAO_PIPE_LOW_SIZE <= 128);
+
+static pipe_item_t m_high_items[NAO_PIPE_HIGH_SIZE];
+static pipe_item_t m_low_items[NAO_PIPE_LOW_SIZE];
+
+static pipe_queue_t m_queues[NAO_PIPE_PRIO_COUNT] =
+{
+    [NAO_PIPE_PRIO_HIGH] = {m_high_items, NAO_PIPE_HIGH_SIZE, 0, 0},
+    [NAO_PIPE_PRIO_LOW]  = {m_low_items,  NAO_PIPE_LOW_SIZE,  0, 0},
+};
+
+static nao_pipe_stats_t   m_stats[NAO_PIPE_PRIO_COUNT];
+static nao_pipe_handler_t m_handler;
+
+
+void nao_pipe_init(nao_pipe_handler_t handler)
+{
+    m_handler = handler;
+
+    for (uint8_t i = 0; i < NAO_PIPE_PRIO_COUNT; i++)
+    {
+        m_queues[i].head = 0;
+        m_queues[i].tail = 0;
+    }
+    memset(m_stats, 0, sizeof(m_stats));
+}
+
+
+uint32_t nao_pipe_put(nao_pipe_prio_t prio, nao_pipe_src_t src, uint8_t const * p_data, uint16_t len)
+{
+    pipe_queue_t     * p_queue = &m_queues[prio];
+    nao_pipe_stats_t * p_stats = &m_stats[prio];
+    pipe_item_t      * p_item;
+    uint8_t            depth;
+    uint32_t           err_code = NRF_SUCCESS;
+
+    if (len > NAO_PIPE_DATA_MAX)
+    {
+        p_stats->dropped++;
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    depth = (uint8_t)(p_queue->head - p_queue->tail);
+    if (depth >= p_queue->size)
+    {
+        p_stats->dropped++;
+        err_code = NRF_ERROR_NO_MEM;
+    }
+    else
+    {
+        p_item = &p_queue->p_items[p_queue->head & (p_queue->size - 1)];
+
+        p_item->put_ticks = app_timer_cnt_get();
+        p_item->len       = len;
+        p_item->src       = src;
+        memcpy(p_item->data, p_data, len);
+
+        p_queue->head++;
+        p_stats->queued++;
+        if (depth + 1 > p_stats->depth_max)
+        {
+            p_stats->depth_max = depth + 1;
+        }
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+void nao_pipe_execute(void)
+{
+    pipe_queue_t * p_queue;
+    pipe_item_t  * p_item;
+    uint32_t       start;
+    uint32_t       wait;
+    uint32_t       run;
+
+    for (;;)
+    {
+        // Answers to the watch go first, telemetry waits until they are out.
+        if (m_queues[NAO_PIPE_PRIO_HIGH].head != m_queues[NAO_PIPE_PRIO_HIGH].tail)
+        {
+            p_queue = &m_queues[NAO_PIPE_PRIO_HIGH];
+        }
+        else if (m_queues[NAO_PIPE_PRIO_LOW].head != m_queues[NAO_PIPE_PRIO_LOW].tail)
+        {
+            p_queue = &m_queues[NAO_PIPE_PRIO_LOW];
+        }
+        else
+        {
+            return;
+        }
+
+        // The slot stays taken until tail moves on, nao_pipe_put() does not touch it meanwhile.
+        p_item = &p_queue->p_items[p_queue->tail & (p_queue->size - 1)];
+
+        start = app_timer_cnt_get();
+        wait  = app_timer_cnt_diff_compute(start, p_item->put_ticks);
+
+        NAO_CYC_START(NAO_CYC_PIPE_PACKET);
+        m_handler((nao_pipe_src_t)p_item->src, p_item->data, p_item->len);
+        NAO_CYC_STOP(NAO_CYC_PIPE_PACKET);
+
+        run = app_timer_cnt_diff_compute(app_timer_cnt_get(), start);
+
+        CRITICAL_REGION_ENTER();
+        p_queue->tail++;
+        CRITICAL_REGION_EXIT();
+
+        nao_pipe_stats_t * p_stats = &m_stats[p_queue - m_queues];
+
+        if (wait > p_stats->wait_max)
+        {
+            p_stats->wait_max = wait;
+        }
+        if (run > p_stats->run_max)
+        {
+            p_stats->run_max = run;
+        }
+    }
+}
+
+
+nao_pipe_stats_t const * nao_pipe_stats_get(nao_pipe_prio_t prio)
+{
+    return &m_stats[prio];
+}
+
+
+void nao_pipe_stats_reset(void)
+{
+    CRITICAL_REGION_ENTER();
+    memset(m_stats, 0, sizeof(m_stats));
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,74 @@
+#ifndef NAO_PIPE_H__
+#define NAO_PIPE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**@brief Pipeline priorities. High is drained completely before each low priority packet. */
+typedef enum
+{
+    NAO_PIPE_PRIO_HIGH,    /**< Watch commands and the lamp's answers to them. */
+    NAO_PIPE_PRIO_LOW,     /**< Periodic lamp telemetry. */
+    NAO_PIPE_PRIO_COUNT
+} nao_pipe_prio_t;
+
+/**@brief Origin of a queued packet, passed on to the handler. */
+typedef enum
+{
+    NAO_PIPE_SRC_WATCH,    /**< Write to the proxy characteristic. */
+    NAO_PIPE_SRC_AUTH,     /**< Notification from NAO+ service 0x13. */
+    NAO_PIPE_SRC_STAT,     /**< Notification from NAO+ service 0x68. */
+    NAO_PIPE_SRC_CONF,     /**< Notification from NAO+ service 0x09. */
+    NAO_PIPE_SRC_REPLAY,   /**< Watch enabled notifications, no data. */
+} nao_pipe_src_t;
+
+/**@brief Metrics of one priority. Times in RTC ticks. */
+typedef struct
+{
+    uint32_t queued;       /**< Packets accepted. */
+    uint32_t dropped;      /**< Packets refused, queue full or packet too long. */
+    uint8_t  depth_max;    /**< Highest number of packets waiting at once. */
+    uint32_t wait_max;     /**< Longest time a packet waited for the main loop. */
+    uint32_t run_max;      /**< Longest time the handler took for one packet. */
+} nao_pipe_stats_t;
+
+#ifndef NAO_PIPE_DATA_MAX
+#define NAO_PIPE_DATA_MAX   244     /**< Largest packet, a watch write at ATT MTU 247. */
+#endif
+
+#ifndef NAO_PIPE_HIGH_SIZE
+#define NAO_PIPE_HIGH_SIZE  4       /**< Slots of the high priority queue, a power of two. */
+#endif
+
+#ifndef NAO_PIPE_LOW_SIZE
+#define NAO_PIPE_LOW_SIZE   8       /**< Slots of the low priority queue, a power of two. */
+#endif
+
+/**@brief Packet handler, called from the main loop. */
+typedef void (*nao_pipe_handler_t)(nao_pipe_src_t src, uint8_t const * p_data, uint16_t len);
+
+/**@brief Function for initializing the pipeline. */
+void nao_pipe_init(nao_pipe_handler_t handler);
+
+/**@brief Function for queueing a copy of a packet, called from the SoftDevice observers.
+ *
+ * @retval NRF_SUCCESS        Packet queued.
+ * @retval NRF_ERROR_NO_MEM   Queue full, the packet is dropped.
+ * @retval NRF_ERROR_INVALID_LENGTH  Packet longer than NAO_PIPE_DATA_MAX, dropped.
+ */
+uint32_t nao_pipe_put(nao_pipe_prio_t prio, nao_pipe_src_t src, uint8_t const * p_data, uint16_t len);
+
+/**@brief Function for handling the queued packets, called from the main loop.
+ *
+ * @details The handler runs with interrupts enabled and may be preempted by the SoftDevice
+ *          observers and timers, state it shares with them needs its own critical region.
+ */
+void nao_pipe_execute(void);
+
+/**@brief Function for getting the metrics of a priority. */
+nao_pipe_stats_t const * nao_pipe_stats_get(nao_pipe_prio_t prio);
+
+/**@brief Function for clearing the metrics of both priorities. */
+void nao_pipe_stats_reset(void);
+
+#endif // NAO_PIPE_H__
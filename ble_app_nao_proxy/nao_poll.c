@@ -0,0 +1,136 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nao_poll.h"
+#include "nrf_error.h"
+#include "nrf_log.h"
+
+
+/**@brief One register read periodically from service 0x09. */
+typedef struct
+{
+    uint16_t type;            /**< Message type of the reply, 0x73 followed by the register. */
+    uint32_t interval_ms;
+    uint32_t next_ms;         /**< Uptime at which the next read is due. */
+    bool     poll_pending;    /**< A proxy read has been sent and not answered yet. */
+    bool     watch_pending;   /**< The watch asked for this register and has not been answered yet. */
+} poll_entry_t;
+
+static poll_entry_t m_poll_table[] =
+{
+    {0x7320, NAO_POLL_PROFILE_NAME_MS},
+    {0x7321, NAO_POLL_PROFILE_NAME_MS},
+    {0x7303, NAO_POLL_REAR_LIGHT_MS},
+};
+
+#define POLL_TABLE_SIZE (sizeof(m_poll_table) / sizeof(m_poll_table[0]))
+
+static nao_poll_read_t m_read_handler;
+static bool            m_running;
+
+
+static poll_entry_t * entry_find(uint16_t type)
+{
+    for (uint8_t i = 0; i < POLL_TABLE_SIZE; i++)
+    {
+        if (m_poll_table[i].type == type)
+        {
+            return &m_poll_table[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+void nao_poll_init(nao_poll_read_t read_handler)
+{
+    m_read_handler = read_handler;
+    m_running      = false;
+}
+
+
+void nao_poll_start(uint32_t now_ms)
+{
+    for (uint8_t i = 0; i < POLL_TABLE_SIZE; i++)
+    {
+        m_poll_table[i].next_ms       = now_ms + m_poll_table[i].interval_ms;
+        m_poll_table[i].poll_pending  = false;
+        m_poll_table[i].watch_pending = false;
+    }
+
+    m_running = true;
+}
+
+
+void nao_poll_stop(void)
+{
+    m_running = false;
+}
+
+
+void nao_poll_process(uint32_t now_ms)
+{
+    if (!m_running || (m_read_handler == NULL))
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < POLL_TABLE_SIZE; i++)
+    {
+        poll_entry_t * p_entry = &m_poll_table[i];
+        uint8_t        cmd[2];
+        uint32_t       err_code;
+
+        // Signed difference, so the uptime wrapping around does not stall the schedule.
+        if ((int32_t)(now_ms - p_entry->next_ms) < 0)
+        {
+            continue;
+        }
+
+        cmd[0] = p_entry->type >> 8;
+        cmd[1] = p_entry->type & 0xFF;
+
+        err_code = m_read_handler(cmd, sizeof(cmd));
+        if (err_code == NRF_SUCCESS)
+        {
+            p_entry->poll_pending = true;
+            p_entry->next_ms      = now_ms + p_entry->interval_ms;
+        }
+        else
+        {
+            // TX queue busy, try again on the next tick.
+            NRF_LOG_DEBUG("poll of %04x deferred: %d", p_entry->type, err_code);
+        }
+    }
+}
+
+
+void nao_poll_watch_request(uint16_t type)
+{
+    poll_entry_t * p_entry = entry_find(type);
+
+    if (p_entry != NULL)
+    {
+        p_entry->watch_pending = true;
+    }
+}
+
+
+bool nao_poll_reply_received(uint16_t type)
+{
+    poll_entry_t * p_entry = entry_find(type);
+    bool           poll_only;
+
+    if (p_entry == NULL)
+    {
+        return false;
+    }
+
+    poll_only = p_entry->poll_pending && !p_entry->watch_pending;
+
+    p_entry->poll_pending  = false;
+    p_entry->watch_pending = false;
+
+    return poll_only;
+}
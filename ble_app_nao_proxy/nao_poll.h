@@ -0,0 +1,43 @@
+#ifndef NAO_POLL_H__
+#define NAO_POLL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef NAO_POLL_PROFILE_NAME_MS
+#define NAO_POLL_PROFILE_NAME_MS   60000   /**< Poll interval of the profile name registers (0x7320, 0x7321). */
+#endif
+
+#ifndef NAO_POLL_REAR_LIGHT_MS
+#define NAO_POLL_REAR_LIGHT_MS     5000    /**< Poll interval of the rear light status register (0x7303). */
+#endif
+
+/**@brief Function type for sending a conf read (0x73 register) to the lamp.
+ *
+ * @param[in]   p_cmd   Read command without the service byte, e.g. {0x73, 0x03}.
+ * @param[in]   len     Length of the read command.
+ */
+typedef uint32_t (*nao_poll_read_t)(uint8_t const * p_cmd, uint16_t len);
+
+/**@brief Function for initializing the polling schedule. */
+void nao_poll_init(nao_poll_read_t read_handler);
+
+/**@brief Function for starting to poll, first reads are due one interval from now. */
+void nao_poll_start(uint32_t now_ms);
+
+/**@brief Function for stopping to poll, e.g. when the lamp disconnects. */
+void nao_poll_stop(void);
+
+/**@brief Function for sending the reads which are due, called from the housekeeping timer. */
+void nao_poll_process(uint32_t now_ms);
+
+/**@brief Function for noting that the watch asked the lamp for a message type itself. */
+void nao_poll_watch_request(uint16_t type);
+
+/**@brief Function for checking a reply from the lamp against the polling schedule.
+ *
+ * @return true if the reply only answers a proxy poll, so the watch needs it only if the value changed.
+ */
+bool nao_poll_reply_received(uint16_t type);
+
+#endif // NAO_POLL_H__
@@ -5,11 +5,23 @@
  */
 
 #include "nao_proxychar.h"
+#include "sdk_common.h"
 #include <string.h>
 #include "nordic_common.h"
 #include "ble_srv_common.h"
 #include "app_util.h"
+#include "app_util_platform.h"
+
+#define NRF_LOG_MODULE_NAME nao_proxy
+#if NAO_PROXY_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       NAO_PROXY_CONFIG_LOG_LEVEL
+#define NRF_LOG_INFO_COLOR  NAO_PROXY_CONFIG_INFO_COLOR
+#define NRF_LOG_DEBUG_COLOR NAO_PROXY_CONFIG_DEBUG_COLOR
+#else // NAO_PROXY_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       0
+#endif // NAO_PROXY_CONFIG_LOG_ENABLED
 #include "nrf_log.h"
+NRF_LOG_MODULE_REGISTER();
 
 
 /**@brief Function for handling the Connect event.
@@ -19,7 +31,8 @@
  */
 static void on_connect(nao_proxy_t * p_nao_proxy, ble_evt_t const * p_ble_evt)
 {
-    p_nao_proxy->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    p_nao_proxy->conn_handle   = p_ble_evt->evt.gap_evt.conn_handle;
+    p_nao_proxy->max_notif_len = NAO_PACKET_SIZE;
 }
 
 
@@ -32,6 +45,115 @@ static void on_disconnect(nao_proxy_t * p_nao_proxy, ble_evt_t const * p_ble_evt
 {
     UNUSED_PARAMETER(p_ble_evt);
     p_nao_proxy->conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_nao_proxy->notif_head  = 0;
+    p_nao_proxy->notif_count = 0;
+    p_nao_proxy->notif_hold  = 0;
+}
+
+
+/**@brief Function for packing queued notifications, oldest first, into one multi-message frame.
+ *
+ * @param[in]   p_nao_proxy       LED Button Service structure.
+ * @param[out]  p_frame           Frame buffer, at least max_notif_len bytes.
+ * @param[out]  p_len             Frame length.
+ *
+ * @return Number of queued notifications packed into the frame.
+ */
+static uint8_t notif_frame_pack(nao_proxy_t * p_nao_proxy, uint8_t * p_frame, uint16_t * p_len)
+{
+    uint8_t  count = 0;
+    uint16_t len   = 1;
+
+    p_frame[0] = NAO_PROXY_FRAME_MARKER;
+
+    while (count < p_nao_proxy->notif_count)
+    {
+        nao_proxy_notif_t const * p_notif = &p_nao_proxy->notif_queue[(p_nao_proxy->notif_head + count) % NAO_PROXY_NOTIF_QUEUE_SIZE];
+
+        if (len + 1 + p_notif->len > p_nao_proxy->max_notif_len)
+        {
+            break;
+        }
+
+        p_frame[len++] = (uint8_t)p_notif->len;
+        memcpy(&p_frame[len], p_notif->data, p_notif->len);
+        len += p_notif->len;
+        count++;
+    }
+
+    *p_len = len;
+
+    return count;
+}
+
+
+/**@brief Function for sending queued notifications until the SoftDevice runs out of buffers.
+ *
+ * @details When the watch link has a larger MTU and more than one notification is queued, as many
+ *          as fit are sent together in one frame.
+ *
+ * @param[in]   p_nao_proxy       LED Button Service structure.
+ */
+static void notif_queue_process(nao_proxy_t * p_nao_proxy)
+{
+    while ((p_nao_proxy->notif_count > 0) &&
+           (p_nao_proxy->notif_hold == 0) &&
+           (p_nao_proxy->conn_handle != BLE_CONN_HANDLE_INVALID))
+    {
+        uint32_t               err_code;
+        ble_gatts_hvx_params_t hvx_params;
+        uint8_t                frame[NAO_PROXY_FRAME_MAX_LEN];
+        nao_proxy_notif_t    * p_notif = &p_nao_proxy->notif_queue[p_nao_proxy->notif_head];
+        uint8_t const        * p_data  = p_notif->data;
+        uint16_t               len     = p_notif->len;
+        uint16_t               sent_len;
+        uint8_t                packed  = 1;
+
+        if ((p_nao_proxy->max_notif_len > NAO_PACKET_SIZE) && (p_nao_proxy->notif_count > 1))
+        {
+            uint16_t frame_len;
+            uint8_t  frame_count = notif_frame_pack(p_nao_proxy, frame, &frame_len);
+
+            // A frame holding a single message gains nothing, send that one as is.
+            if (frame_count > 1)
+            {
+                p_data = frame;
+                len    = frame_len;
+                packed = frame_count;
+            }
+        }
+
+        sent_len = len;
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_nao_proxy->nao_notif_char_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &sent_len;
+        hvx_params.p_data = p_data;
+
+        err_code = sd_ble_gatts_hvx(p_nao_proxy->conn_handle, &hvx_params);
+
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            // SoftDevice queue full, continue on BLE_GATTS_EVT_HVN_TX_COMPLETE.
+            break;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            NRF_LOG_INFO("notification dropped, hvx returned: %d", err_code);
+            p_nao_proxy->notif_stats.error_drops += packed;
+        }
+        else if (sent_len != len)
+        {
+            NRF_LOG_DEBUG("wrote %d bytes", sent_len);
+        }
+
+        p_nao_proxy->notif_head   = (p_nao_proxy->notif_head + packed) % NAO_PROXY_NOTIF_QUEUE_SIZE;
+        p_nao_proxy->notif_count -= packed;
+    }
 }
 
 
@@ -44,7 +166,7 @@ static void on_write(nao_proxy_t * p_nao_proxy, ble_evt_t const * p_ble_evt)
 {
     ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
  
-    NRF_LOG_INFO("Received packet len : %d",p_evt_write->len);
+    NRF_LOG_DEBUG("Received packet len : %d",p_evt_write->len);
       
     if ((p_evt_write->handle == p_nao_proxy->nao_write_char_handles.value_handle) &&
         (p_nao_proxy->nao_write_handler != NULL))
@@ -69,6 +191,10 @@ void nao_proxy_on_ble_evt(nao_proxy_t * p_nao_proxy, ble_evt_t const * p_ble_evt
         case BLE_GATTS_EVT_WRITE:
             on_write(p_nao_proxy, p_ble_evt);
             break;
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            notif_queue_process(p_nao_proxy);
+            break;
             
         default:
             // No implementation needed.
@@ -107,7 +233,7 @@ static uint32_t nao_write_char_add(nao_proxy_t * p_nao_proxy, const nao_proxy_in
     attr_md.vloc       = BLE_GATTS_VLOC_STACK;
     attr_md.rd_auth    = 0;
     attr_md.wr_auth    = 0;
-    attr_md.vlen       = 0;
+    attr_md.vlen       = 1;
     
     memset(&attr_char_value, 0, sizeof(attr_char_value));
 
@@ -115,7 +241,7 @@ static uint32_t nao_write_char_add(nao_proxy_t * p_nao_proxy, const nao_proxy_in
     attr_char_value.p_attr_md    = &attr_md;
     attr_char_value.init_len     = NAO_PACKET_SIZE+1; // additional byte for service addr on NAO (09,13,68), max packet len = 21 bytes
     attr_char_value.init_offs    = 0;
-    attr_char_value.max_len      = NAO_PACKET_SIZE+1; 
+    attr_char_value.max_len      = NAO_PROXY_FRAME_MAX_LEN; // batched commands (NAO_PROXY_BATCH_CMD) can use the whole MTU
     attr_char_value.p_value      = NULL;
     
     return sd_ble_gatts_characteristic_add(p_nao_proxy->service_handle, &char_md,
@@ -160,7 +286,7 @@ static uint32_t nao_notif_char_add(nao_proxy_t * p_nao_proxy, const nao_proxy_in
     attr_md.vloc       = BLE_GATTS_VLOC_STACK;
     attr_md.rd_auth    = 0;
     attr_md.wr_auth    = 0;
-    attr_md.vlen       = 0;
+    attr_md.vlen       = 1;
     
     memset(&attr_char_value, 0, sizeof(attr_char_value));
 
@@ -168,7 +294,7 @@ static uint32_t nao_notif_char_add(nao_proxy_t * p_nao_proxy, const nao_proxy_in
     attr_char_value.p_attr_md    = &attr_md;
     attr_char_value.init_len     = NAO_PACKET_SIZE;
     attr_char_value.init_offs    = 0;
-    attr_char_value.max_len      = NAO_PACKET_SIZE;
+    attr_char_value.max_len      = NAO_PROXY_FRAME_MAX_LEN;
     attr_char_value.p_value      = NULL;
     
     return sd_ble_gatts_characteristic_add(p_nao_proxy->service_handle, &char_md,
@@ -184,6 +310,11 @@ uint32_t nao_proxy_init(nao_proxy_t * p_nao_proxy, const nao_proxy_init_t * p_na
     // Initialize service structure
     p_nao_proxy->conn_handle       = BLE_CONN_HANDLE_INVALID;
     p_nao_proxy->nao_write_handler = p_nao_proxy_init->nao_write_handler;
+    p_nao_proxy->max_notif_len     = NAO_PACKET_SIZE;
+    p_nao_proxy->notif_head        = 0;
+    p_nao_proxy->notif_count       = 0;
+    p_nao_proxy->notif_hold        = 0;
+    memset(&p_nao_proxy->notif_stats, 0, sizeof(p_nao_proxy->notif_stats));
     
     // Add service
     ble_uuid128_t base_uuid = {NAO_PROXY_UUID_BASE};
@@ -232,3 +363,147 @@ uint32_t nao_proxy_on_nao_notif(nao_proxy_t * p_nao_proxy, uint8_t *nao_notif_da
 }
 
 
+/**@brief Function for getting the NAO+ message type of a notification (first two bytes, big endian).
+ *
+ * @details Proxy replies (0x69) have no type, a multi-page reply shares its first two bytes and
+ *          every page has to reach the watch.
+ */
+static uint16_t notif_msg_type(uint8_t const * p_data, uint16_t len)
+{
+    if ((len < 2) || (p_data[0] == 0x69))
+    {
+        return 0;
+    }
+    return (uint16_t)((p_data[0] << 8) | p_data[1]);
+}
+
+
+/**@brief Function for ticking off an expected batch reply.
+ */
+static void notif_hold_match(nao_proxy_t * p_nao_proxy, uint16_t type)
+{
+    for (uint8_t i = 0; (i < p_nao_proxy->notif_hold) && (type != 0); i++)
+    {
+        if (p_nao_proxy->notif_hold_types[i] == type)
+        {
+            p_nao_proxy->notif_hold--;
+            p_nao_proxy->notif_hold_types[i] = p_nao_proxy->notif_hold_types[p_nao_proxy->notif_hold];
+            return;
+        }
+    }
+}
+
+
+uint32_t nao_proxy_notif_send(nao_proxy_t * p_nao_proxy, uint8_t const * p_data, uint16_t len)
+{
+    nao_proxy_notif_t * p_notif = NULL;
+    uint16_t            type    = notif_msg_type(p_data, len);
+
+    if (p_nao_proxy->conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (len > NAO_PACKET_SIZE)
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    // The queue is also drained from the SoftDevice observer on HVN TX complete.
+    CRITICAL_REGION_ENTER();
+
+    // A newer message of the same type supersedes the queued one, it keeps its place in the queue.
+    for (uint8_t i = 0; (i < p_nao_proxy->notif_count) && (type != 0); i++)
+    {
+        nao_proxy_notif_t * p_queued = &p_nao_proxy->notif_queue[(p_nao_proxy->notif_head + i) % NAO_PROXY_NOTIF_QUEUE_SIZE];
+
+        if (notif_msg_type(p_queued->data, p_queued->len) == type)
+        {
+            p_notif = p_queued;
+            p_nao_proxy->notif_stats.superseded++;
+            break;
+        }
+    }
+
+    if (p_notif == NULL)
+    {
+        if (p_nao_proxy->notif_count == NAO_PROXY_NOTIF_QUEUE_SIZE)
+        {
+            NRF_LOG_INFO("notification queue full, dropping oldest");
+            p_nao_proxy->notif_head = (p_nao_proxy->notif_head + 1) % NAO_PROXY_NOTIF_QUEUE_SIZE;
+            p_nao_proxy->notif_count--;
+            p_nao_proxy->notif_stats.overflow_drops++;
+        }
+
+        p_notif = &p_nao_proxy->notif_queue[(p_nao_proxy->notif_head + p_nao_proxy->notif_count) % NAO_PROXY_NOTIF_QUEUE_SIZE];
+        p_nao_proxy->notif_count++;
+
+        if (p_nao_proxy->notif_count > p_nao_proxy->notif_stats.high_water)
+        {
+            p_nao_proxy->notif_stats.high_water = p_nao_proxy->notif_count;
+        }
+    }
+
+    memcpy(p_notif->data, p_data, len);
+    p_notif->len = len;
+
+    notif_hold_match(p_nao_proxy, type);
+
+    notif_queue_process(p_nao_proxy);
+
+    CRITICAL_REGION_EXIT();
+
+    return NRF_SUCCESS;
+}
+
+
+void nao_proxy_att_mtu_set(nao_proxy_t * p_nao_proxy, uint16_t att_mtu)
+{
+    uint16_t max_len = att_mtu - 3;
+
+    p_nao_proxy->max_notif_len = MIN(MAX(max_len, NAO_PACKET_SIZE), NAO_PROXY_FRAME_MAX_LEN);
+
+    NRF_LOG_INFO("watch link notifications up to %d bytes", p_nao_proxy->max_notif_len);
+
+    CRITICAL_REGION_ENTER();
+    notif_queue_process(p_nao_proxy);
+    CRITICAL_REGION_EXIT();
+}
+
+
+void nao_proxy_notif_hold(nao_proxy_t * p_nao_proxy, uint16_t const * p_types, uint8_t count)
+{
+    // Holding more than the queue can take would only push out the first replies.
+    count = MIN(count, NAO_PROXY_NOTIF_QUEUE_SIZE);
+
+    CRITICAL_REGION_ENTER();
+    memcpy(p_nao_proxy->notif_hold_types, p_types, count * sizeof(uint16_t));
+    p_nao_proxy->notif_hold = count;
+    notif_queue_process(p_nao_proxy);  // nothing to wait for, or a previous hold ends
+    CRITICAL_REGION_EXIT();
+}
+
+
+void nao_proxy_notif_release(nao_proxy_t * p_nao_proxy)
+{
+    CRITICAL_REGION_ENTER();
+    p_nao_proxy->notif_hold = 0;
+    notif_queue_process(p_nao_proxy);
+    CRITICAL_REGION_EXIT();
+}
+
+
+void nao_proxy_notif_stats_get(nao_proxy_t const * p_nao_proxy, nao_proxy_notif_stats_t * p_stats)
+{
+    *p_stats       = p_nao_proxy->notif_stats;
+    p_stats->depth = p_nao_proxy->notif_count;
+}
+
+
+void nao_proxy_notif_stats_reset(nao_proxy_t * p_nao_proxy)
+{
+    CRITICAL_REGION_ENTER();
+    memset(&p_nao_proxy->notif_stats, 0, sizeof(p_nao_proxy->notif_stats));
+    p_nao_proxy->notif_stats.high_water = p_nao_proxy->notif_count;
+    CRITICAL_REGION_EXIT();
+}
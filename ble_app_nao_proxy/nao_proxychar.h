@@ -11,6 +11,7 @@
 #include <stdbool.h>
 #include "ble.h"
 #include "ble_srv_common.h"
+#include "sdk_config.h"
 
 #define NAO_PROXY_UUID_BASE {0x23, 0xD1, 0xBC, 0xEA, 0x66, 0x66, 0x66, 0x66, 0xDE, 0xEF, 0x12, 0x12, 0x00, 0x00, 0x00, 0x00}
 #define NAO_PROXY_UUID_SERVICE 0x1523
@@ -19,6 +20,14 @@
 
 #define NAO_PACKET_SIZE 20
 
+#define NAO_PROXY_FRAME_MARKER  0xFE                                /**< First byte of a notification carrying several NAO+ messages, each prefixed by its length byte. */
+#define NAO_PROXY_FRAME_MAX_LEN (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3) /**< Longest notification the watch link can carry with the largest negotiated ATT MTU. */
+#define NAO_PROXY_BATCH_CMD     0xFE                                /**< First byte of a write carrying several commands, each prefixed by its length byte. */
+
+#ifndef NAO_PROXY_NOTIF_QUEUE_SIZE
+#define NAO_PROXY_NOTIF_QUEUE_SIZE 8      /**< Depth of the outbound notification queue towards the watch. */
+#endif
+
 // Forward declaration of the nao_proxy_t type. 
 typedef struct nao_proxy_s nao_proxy_t;
 
@@ -29,6 +38,23 @@ typedef struct
     nao_proxy_nao_write_handler_t nao_write_handler;                    /**< Event handler to be called when LED characteristic is written. */
 } nao_proxy_init_t;
 
+/**@brief Notification waiting to be sent to the watch. */
+typedef struct
+{
+    uint16_t                    len;
+    uint8_t                     data[NAO_PACKET_SIZE];
+} nao_proxy_notif_t;
+
+/**@brief Outbound notification queue statistics. */
+typedef struct
+{
+    uint8_t                     depth;              /**< Notifications currently queued. */
+    uint8_t                     high_water;         /**< Highest number of notifications queued at the same time. */
+    uint32_t                    superseded;         /**< Queued notifications dropped because a newer one of the same message type arrived. */
+    uint32_t                    overflow_drops;     /**< Oldest notifications dropped because the queue was full. */
+    uint32_t                    error_drops;        /**< Notifications dropped because the SoftDevice rejected them (e.g. notifications not enabled). */
+} nao_proxy_notif_stats_t;
+
 /**@brief LED Button Service structure. This contains various status information for the service. */
 typedef struct nao_proxy_s
 {
@@ -38,6 +64,13 @@ typedef struct nao_proxy_s
     uint8_t                     uuid_type;
     uint16_t                    conn_handle;
     nao_proxy_nao_write_handler_t nao_write_handler;
+    uint16_t                    max_notif_len;      /**< Notification payload the watch link can take (ATT MTU - 3), NAO_PACKET_SIZE until the MTU is exchanged. */
+    nao_proxy_notif_t           notif_queue[NAO_PROXY_NOTIF_QUEUE_SIZE];  /**< Notifications not yet accepted by the SoftDevice, oldest at notif_head. */
+    uint8_t                     notif_head;
+    uint8_t                     notif_count;
+    uint16_t                    notif_hold_types[NAO_PROXY_NOTIF_QUEUE_SIZE];  /**< Message types of the batch replies still expected. */
+    uint8_t                     notif_hold;         /**< Batch replies still expected, queued notifications are held back while non-zero. */
+    nao_proxy_notif_stats_t     notif_stats;
 } nao_proxy_t;
 
 /**@brief Function for initializing the LED Button Service.
@@ -65,6 +98,49 @@ void nao_proxy_on_ble_evt(nao_proxy_t * p_nao_proxy, ble_evt_t const * p_ble_evt
  */
 uint32_t nao_proxy_on_nao_notif(nao_proxy_t * p_nao_proxy, uint8_t *nao_notif_data);
 
+/**@brief Function for queueing a notification to the watch.
+ *
+ * @details The data is copied, so the caller's buffer can be reused right away. Queued notifications
+ *          are sent as the SoftDevice frees buffers (BLE_GATTS_EVT_HVN_TX_COMPLETE). A queued
+ *          notification is replaced by a newer one with the same message type (first two bytes),
+ *          and when the queue is full the oldest notification is dropped.
+ *
+ * @return NRF_SUCCESS if queued, NRF_ERROR_INVALID_STATE if the watch is not connected,
+ *         NRF_ERROR_INVALID_LENGTH if the data does not fit a notification.
+ */
+uint32_t nao_proxy_notif_send(nao_proxy_t * p_nao_proxy, uint8_t const * p_data, uint16_t len);
+
+/**@brief Function for setting the ATT MTU negotiated on the watch link.
+ *
+ * @details With an MTU above the default, queued NAO+ messages are packed into one notification:
+ *          NAO_PROXY_FRAME_MARKER followed by [length][message] for each message. A single queued
+ *          message is always sent as is, so watches staying at the default MTU see plain 20 byte
+ *          notifications.
+ */
+void nao_proxy_att_mtu_set(nao_proxy_t * p_nao_proxy, uint16_t att_mtu);
+
+/**@brief Function for holding back notifications until the replies to a batch have been queued.
+ *
+ * @details Used for batched commands, so their replies reach the watch together (in one frame
+ *          when the MTU allows). Each notification of one of the @p count message types in
+ *          @p p_types ticks off one reply, other notifications (telemetry) are held back with the
+ *          rest. The hold ends when all replies are queued or on @ref nao_proxy_notif_release,
+ *          whichever comes first.
+ */
+void nao_proxy_notif_hold(nao_proxy_t * p_nao_proxy, uint16_t const * p_types, uint8_t count);
+
+/**@brief Function for ending a hold and sending the queued notifications.
+ */
+void nao_proxy_notif_release(nao_proxy_t * p_nao_proxy);
+
+/**@brief Function for reading the outbound notification queue statistics.
+ */
+void nao_proxy_notif_stats_get(nao_proxy_t const * p_nao_proxy, nao_proxy_notif_stats_t * p_stats);
+
+/**@brief Function for clearing the outbound notification queue statistics.
+ */
+void nao_proxy_notif_stats_reset(nao_proxy_t * p_nao_proxy);
+
 #endif // BLE_LBS_H__
 
 /** @} */
@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "nao_scan_policy.h"
+#include "nrf_log.h"
+
+
+/**@brief Scan parameters of one stage. Interval and window are in 0.625 ms units. */
+typedef struct
+{
+    uint16_t interval;
+    uint16_t window;
+    uint32_t duration_ms;   /**< Time before moving to the next stage, 0 for the last stage. */
+} scan_stage_params_t;
+
+static const scan_stage_params_t m_stages[NAO_SCAN_STAGE_COUNT] =
+{
+    [NAO_SCAN_STAGE_BURST] = {48,   48, NAO_SCAN_BURST_MS},  // 30 ms / 30 ms
+    [NAO_SCAN_STAGE_FAST]  = {160,  80, NAO_SCAN_FAST_MS},   // 100 ms / 50 ms
+    [NAO_SCAN_STAGE_SLOW]  = {800,  40, NAO_SCAN_SLOW_MS},   // 500 ms / 25 ms
+    [NAO_SCAN_STAGE_IDLE]  = {2048, 18, 0},                  // 1.28 s / 11.25 ms
+};
+
+static nao_scan_stage_t m_stage = NAO_SCAN_STAGE_FAST;
+static uint32_t         m_stage_start_ms;
+
+
+void nao_scan_policy_burst(uint32_t now_ms)
+{
+    m_stage          = NAO_SCAN_STAGE_BURST;
+    m_stage_start_ms = now_ms;
+}
+
+
+bool nao_scan_policy_process(uint32_t now_ms)
+{
+    uint32_t duration_ms = m_stages[m_stage].duration_ms;
+
+    if ((duration_ms == 0) || ((now_ms - m_stage_start_ms) < duration_ms))
+    {
+        return false;
+    }
+
+    m_stage++;
+    m_stage_start_ms = now_ms;
+
+    NRF_LOG_INFO("scan stage %d: interval %d, window %d", m_stage, m_stages[m_stage].interval, m_stages[m_stage].window);
+
+    return true;
+}
+
+
+nao_scan_stage_t nao_scan_policy_stage_get(void)
+{
+    return m_stage;
+}
+
+
+void nao_scan_policy_params_apply(ble_gap_scan_params_t * p_scan_params)
+{
+    p_scan_params->interval = m_stages[m_stage].interval;
+    p_scan_params->window   = m_stages[m_stage].window;
+}
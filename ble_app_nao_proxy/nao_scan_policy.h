@@ -0,0 +1,45 @@
+#ifndef NAO_SCAN_POLICY_H__
+#define NAO_SCAN_POLICY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+
+/**@brief Scan duty-cycle stages, from fast lamp acquisition to battery saving. */
+typedef enum
+{
+    NAO_SCAN_STAGE_BURST,   /**< Continuous scanning right after the watch connected. */
+    NAO_SCAN_STAGE_FAST,    /**< 50 % duty cycle, the former fixed setting. */
+    NAO_SCAN_STAGE_SLOW,    /**< 5 % duty cycle, lamp probably off or out of range. */
+    NAO_SCAN_STAGE_IDLE,    /**< About 1 % duty cycle, kept until the next burst. */
+    NAO_SCAN_STAGE_COUNT
+} nao_scan_stage_t;
+
+#ifndef NAO_SCAN_BURST_MS
+#define NAO_SCAN_BURST_MS  15000     /**< Time spent in NAO_SCAN_STAGE_BURST. */
+#endif
+
+#ifndef NAO_SCAN_FAST_MS
+#define NAO_SCAN_FAST_MS   60000     /**< Time spent in NAO_SCAN_STAGE_FAST. */
+#endif
+
+#ifndef NAO_SCAN_SLOW_MS
+#define NAO_SCAN_SLOW_MS   600000    /**< Time spent in NAO_SCAN_STAGE_SLOW. */
+#endif
+
+/**@brief Function for restarting at NAO_SCAN_STAGE_BURST, e.g. when the watch connects. */
+void nao_scan_policy_burst(uint32_t now_ms);
+
+/**@brief Function for advancing the stage, called from the housekeeping timer while scanning.
+ *
+ * @return true if the stage changed, the scan has to be restarted with the new parameters.
+ */
+bool nao_scan_policy_process(uint32_t now_ms);
+
+/**@brief Function for getting the current stage. */
+nao_scan_stage_t nao_scan_policy_stage_get(void);
+
+/**@brief Function for setting the interval and window of the current stage in scan parameters. */
+void nao_scan_policy_params_apply(ble_gap_scan_params_t * p_scan_params);
+
+#endif // NAO_SCAN_POLICY_H__
@@ -1,5 +1,6 @@
 #include <stdlib.h> // definition of NULL
 
+#include "sdk_common.h"
 #include "ble.h"
 #include "ble_gattc.h"
 #include "ble_srv_common.h"
@@ -8,7 +9,17 @@
 #include "ble_gatt.h"
 #include "nao_service_09.h"
 #include "nao_generic.h"
+
+#define NRF_LOG_MODULE_NAME nao_conf_c
+#if NAO_CONF_C_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       NAO_CONF_C_CONFIG_LOG_LEVEL
+#define NRF_LOG_INFO_COLOR  NAO_CONF_C_CONFIG_INFO_COLOR
+#define NRF_LOG_DEBUG_COLOR NAO_CONF_C_CONFIG_DEBUG_COLOR
+#else // NAO_CONF_C_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       0
+#endif // NAO_CONF_C_CONFIG_LOG_ENABLED
 #include "nrf_log.h"
+NRF_LOG_MODULE_REGISTER();
 
 
 void ble_nao_conf_c_on_db_disc_evt(ble_nao_conf_c_t * p_ble_nao_conf_c, ble_db_discovery_evt_t * p_evt)
@@ -81,6 +92,14 @@ static void ble_nao_conf_on_hvx(ble_nao_conf_c_t * p_ble_nao_conf_c, const ble_e
     }
 }
 
+
+/**@brief Function for receiving the notifications of the NAO_CONF RX characteristic from the dispatch table.
+ */
+static void ble_nao_conf_hvx_dispatch(void * p_context, ble_evt_t const * p_ble_evt)
+{
+    ble_nao_conf_on_hvx((ble_nao_conf_c_t *)p_context, p_ble_evt);
+}
+
 uint32_t ble_nao_conf_c_init(ble_nao_conf_c_t * p_ble_nao_conf_c, ble_nao_conf_c_init_t * p_ble_nao_conf_c_init)
 {
     uint32_t      err_code;
@@ -105,33 +124,6 @@ uint32_t ble_nao_conf_c_init(ble_nao_conf_c_t * p_ble_nao_conf_c, ble_nao_conf_c
 }
 
 
-static void ble_nao_conf_on_write_rsp(ble_nao_conf_c_t * p_ble_nao_conf_c, const ble_evt_t * p_ble_evt)
-{
-    // Check if the event if on the link for this instance
-    if (p_ble_nao_conf_c->conn_handle != p_ble_evt->evt.gattc_evt.conn_handle)
-    {
-        return;
-    }
-
-    if ((p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION) ||
-        (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION))
-    {
-        // Do nothing to reattempt write.
-    }
-    else
-    {
-        if(p_ble_nao_conf_c->conn_handle == p_ble_evt->evt.gap_evt.conn_handle)
-         {
-          NRF_LOG_INFO("Received write response to write request (0x09)\r\n");
-          notif_09_subbed = true;
-         }
-    }
-
-    // Check if there is any message to be sent across to the peer and send it.
-    tx_buffer_process();
-}
-
-
 void ble_nao_conf_c_on_ble_evt(ble_nao_conf_c_t * p_ble_nao_conf_c, const ble_evt_t * p_ble_evt)
 {
     if ((p_ble_nao_conf_c == NULL) || (p_ble_evt == NULL))
@@ -148,10 +140,6 @@ void ble_nao_conf_c_on_ble_evt(ble_nao_conf_c_t * p_ble_nao_conf_c, const ble_ev
 
     switch (p_ble_evt->header.evt_id)
     {
-        case BLE_GATTC_EVT_HVX:
-            ble_nao_conf_on_hvx(p_ble_nao_conf_c, p_ble_evt);
-            break;
-                
         case BLE_GAP_EVT_DISCONNECTED:
             if (p_ble_evt->evt.gap_evt.conn_handle == p_ble_nao_conf_c->conn_handle
                     && p_ble_nao_conf_c->evt_handler != NULL)
@@ -164,11 +152,6 @@ void ble_nao_conf_c_on_ble_evt(ble_nao_conf_c_t * p_ble_nao_conf_c, const ble_ev
                 p_ble_nao_conf_c->evt_handler(p_ble_nao_conf_c, &nao_conf_c_evt);
             }
             break;
-
-         case BLE_GATTC_EVT_WRITE_RSP:
-            //ble_nao_conf_on_write_rsp(p_ble_nao_conf_c, p_ble_evt);
-            break;
-
     }
 }
 
@@ -224,6 +207,10 @@ uint32_t ble_nao_conf_c_handles_assign(ble_nao_conf_c_t * p_ble_nao_conf,
         p_ble_nao_conf->handles.nao_conf_rx_cccd_handle = p_peer_handles->nao_conf_rx_cccd_handle;
         p_ble_nao_conf->handles.nao_conf_rx_handle      = p_peer_handles->nao_conf_rx_handle;
         p_ble_nao_conf->handles.nao_conf_tx_handle      = p_peer_handles->nao_conf_tx_handle;    
+
+        // Notifications of the RX characteristic go straight to this instance.
+        return nao_gattc_dispatch_register(conn_handle, p_peer_handles->nao_conf_rx_handle,
+                                           ble_nao_conf_hvx_dispatch, p_ble_nao_conf);
     }
     return NRF_SUCCESS;
 }
@@ -1,5 +1,6 @@
 #include <stdlib.h> // definition of NULL
 
+#include "sdk_common.h"
 #include "ble.h"
 #include "ble_gattc.h"
 #include "ble_srv_common.h"
@@ -8,7 +9,17 @@
 #include "ble_gatt.h"
 #include "nao_service_13.h"
 #include "nao_generic.h"
+
+#define NRF_LOG_MODULE_NAME nao_auth_c
+#if NAO_AUTH_C_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       NAO_AUTH_C_CONFIG_LOG_LEVEL
+#define NRF_LOG_INFO_COLOR  NAO_AUTH_C_CONFIG_INFO_COLOR
+#define NRF_LOG_DEBUG_COLOR NAO_AUTH_C_CONFIG_DEBUG_COLOR
+#else // NAO_AUTH_C_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       0
+#endif // NAO_AUTH_C_CONFIG_LOG_ENABLED
 #include "nrf_log.h"
+NRF_LOG_MODULE_REGISTER();
 
 
 void ble_nao_auth_c_on_db_disc_evt(ble_nao_auth_c_t * p_ble_nao_auth_c, ble_db_discovery_evt_t * p_evt)
@@ -81,6 +92,14 @@ static void ble_nao_auth_on_hvx(ble_nao_auth_c_t * p_ble_nao_auth_c, const ble_e
     }
 }
 
+
+/**@brief Function for receiving the notifications of the NAO_AUTH RX characteristic from the dispatch table.
+ */
+static void ble_nao_auth_hvx_dispatch(void * p_context, ble_evt_t const * p_ble_evt)
+{
+    ble_nao_auth_on_hvx((ble_nao_auth_c_t *)p_context, p_ble_evt);
+}
+
 uint32_t ble_nao_auth_c_init(ble_nao_auth_c_t * p_ble_nao_auth_c, ble_nao_auth_c_init_t * p_ble_nao_auth_c_init)
 {
     uint32_t      err_code;
@@ -105,35 +124,6 @@ uint32_t ble_nao_auth_c_init(ble_nao_auth_c_t * p_ble_nao_auth_c, ble_nao_auth_c
 }
 
 
-static void ble_nao_auth_on_write_rsp(ble_nao_auth_c_t * p_ble_nao_auth_c, const ble_evt_t * p_ble_evt)
-    {
-    // Check if the event if on the link for this instance
-    if (p_ble_nao_auth_c->conn_handle != p_ble_evt->evt.gattc_evt.conn_handle) 
-    {
-        return;
-    }
-
-    if ((p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION) ||
-        (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION))
-    {
-        // Do nothing to reattempt write.
-    }
-    else
-    {
-        if(p_ble_nao_auth_c->conn_handle == p_ble_evt->evt.gap_evt.conn_handle)
-         {
-          NRF_LOG_INFO("Received write response to write request (0x13)\r\n");
-          notif_13_subbed = true;
-         }
-    }
-   
-
-    // Check if there is any message to be sent across to the peer and send it.
-    tx_buffer_process();
-}
-
-
-
 void ble_nao_auth_c_on_ble_evt(ble_nao_auth_c_t * p_ble_nao_auth_c, const ble_evt_t * p_ble_evt)
 {
     if ((p_ble_nao_auth_c == NULL) || (p_ble_evt == NULL))
@@ -150,10 +140,6 @@ void ble_nao_auth_c_on_ble_evt(ble_nao_auth_c_t * p_ble_nao_auth_c, const ble_ev
 
     switch (p_ble_evt->header.evt_id)
     {
-        case BLE_GATTC_EVT_HVX:
-            ble_nao_auth_on_hvx(p_ble_nao_auth_c, p_ble_evt);
-            break;
-                
         case BLE_GAP_EVT_DISCONNECTED:
             if (p_ble_evt->evt.gap_evt.conn_handle == p_ble_nao_auth_c->conn_handle
                     && p_ble_nao_auth_c->evt_handler != NULL)
@@ -166,11 +152,6 @@ void ble_nao_auth_c_on_ble_evt(ble_nao_auth_c_t * p_ble_nao_auth_c, const ble_ev
                 p_ble_nao_auth_c->evt_handler(p_ble_nao_auth_c, &nao_auth_c_evt);
             }
             break;
-
-         case BLE_GATTC_EVT_WRITE_RSP:
-            ble_nao_auth_on_write_rsp(p_ble_nao_auth_c, p_ble_evt);
-            break;
-
     }
 }
 
@@ -201,16 +182,8 @@ uint32_t ble_nao_auth_c_send_auth(ble_nao_auth_c_t * p_ble_nao_auth_c)
         return NRF_ERROR_INVALID_STATE;
     }
 
-    const ble_gattc_write_params_t write_params = {
-        .write_op = BLE_GATT_OP_WRITE_CMD,
-        .flags    = BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE,
-        .handle   = p_ble_nao_auth_c->handles.nao_auth_tx_handle,
-        .offset   = 0,
-        .len      = sizeof(buf),
-        .p_value  = buf
-    };
-
-    return sd_ble_gattc_write(p_ble_nao_auth_c->conn_handle, &write_params);
+    // Queued behind the CCCD writes of this link, so the lamp's answer is not lost.
+    return ble_nao_characteristic_write(p_ble_nao_auth_c->conn_handle, p_ble_nao_auth_c->handles.nao_auth_tx_handle, buf, sizeof(buf));
 
 }
 
@@ -254,6 +227,10 @@ uint32_t ble_nao_auth_c_handles_assign(ble_nao_auth_c_t * p_ble_nao_auth,
         p_ble_nao_auth->handles.nao_auth_rx_cccd_handle = p_peer_handles->nao_auth_rx_cccd_handle;
         p_ble_nao_auth->handles.nao_auth_rx_handle      = p_peer_handles->nao_auth_rx_handle;
         p_ble_nao_auth->handles.nao_auth_tx_handle      = p_peer_handles->nao_auth_tx_handle;    
+
+        // Notifications of the RX characteristic go straight to this instance.
+        return nao_gattc_dispatch_register(conn_handle, p_peer_handles->nao_auth_rx_handle,
+                                           ble_nao_auth_hvx_dispatch, p_ble_nao_auth);
     }
     return NRF_SUCCESS;
 }
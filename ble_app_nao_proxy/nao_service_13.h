@@ -65,8 +65,6 @@ typedef struct {
 } ble_nao_auth_c_init_t;
 
 
-static bool notif_13_subbed;
-
 void ble_nao_auth_c_on_db_disc_evt(ble_nao_auth_c_t * p_ble_nao_auth_c, ble_db_discovery_evt_t * p_evt);
 uint32_t ble_nao_auth_c_init(ble_nao_auth_c_t * p_ble_nao_auth_c, ble_nao_auth_c_init_t * p_ble_nao_auth_c_init);
 void ble_nao_auth_c_on_ble_evt(ble_nao_auth_c_t * p_ble_nao_auth_c, const ble_evt_t * p_ble_evt);
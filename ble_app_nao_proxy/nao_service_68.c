@@ -1,5 +1,6 @@
 #include <stdlib.h> // definition of NULL
 
+#include "sdk_common.h"
 #include "ble.h"
 #include "ble_gattc.h"
 #include "ble_srv_common.h"
@@ -9,44 +10,33 @@
 #include "nao_service_68.h"
 #include "nao_generic.h"
 #include "nao_proxychar.h"
+#include "nao_cyc.h"
+
+#define NRF_LOG_MODULE_NAME nao_stat_c
+#if NAO_STAT_C_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       NAO_STAT_C_CONFIG_LOG_LEVEL
+#define NRF_LOG_INFO_COLOR  NAO_STAT_C_CONFIG_INFO_COLOR
+#define NRF_LOG_DEBUG_COLOR NAO_STAT_C_CONFIG_DEBUG_COLOR
+#else // NAO_STAT_C_CONFIG_LOG_ENABLED
+#define NRF_LOG_LEVEL       0
+#endif // NAO_STAT_C_CONFIG_LOG_ENABLED
 #include "nrf_log.h"
+NRF_LOG_MODULE_REGISTER();
 
 
 
 uint32_t ble_nao_stat_notif_forward(nao_proxy_t * p_proxy, uint8_t *data, uint16_t data_len)
 {
     uint32_t err_code;
-    uint16_t len;
 
-    // Send value if connected and notifying
-    if (p_proxy->conn_handle != BLE_CONN_HANDLE_INVALID)
-    {
-        ble_gatts_hvx_params_t hvx_params;
-
-        len = data_len;
-
-        memset(&hvx_params, 0, sizeof(hvx_params));
+    NAO_CYC_START(NAO_CYC_NOTIF_FORWARD);
 
-        hvx_params.handle = p_proxy->nao_notif_char_handles.value_handle;
-        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-        hvx_params.offset = 0;
-        hvx_params.p_len  = &data_len;
-        hvx_params.p_data = data;
+    NRF_LOG_DEBUG("sending notification to peripheral: data len:%d",data_len);
 
-        NRF_LOG_INFO("sending notification to peripheral: data len:%d",*hvx_params.p_len);
+    // Queued on the proxy service, sent as the SoftDevice frees notification buffers.
+    err_code = nao_proxy_notif_send(p_proxy, data, data_len);
 
-        err_code = sd_ble_gatts_hvx(p_proxy->conn_handle, &hvx_params);
-
-        if ((err_code == NRF_SUCCESS) && (*hvx_params.p_len != len))
-        {
-            NRF_LOG_INFO("wrote %d bytes",*hvx_params.p_len);
-            err_code = NRF_ERROR_DATA_SIZE;
-        }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
+    NAO_CYC_STOP(NAO_CYC_NOTIF_FORWARD);
 
     return err_code;
 }
@@ -124,6 +114,14 @@ static void ble_nao_stat_on_hvx(ble_nao_stat_c_t * p_ble_nao_stat_c, const ble_e
     }
 }
 
+
+/**@brief Function for receiving the notifications of the NAO_STAT RX characteristic from the dispatch table.
+ */
+static void ble_nao_stat_hvx_dispatch(void * p_context, ble_evt_t const * p_ble_evt)
+{
+    ble_nao_stat_on_hvx((ble_nao_stat_c_t *)p_context, p_ble_evt);
+}
+
 uint32_t ble_nao_stat_c_init(ble_nao_stat_c_t * p_ble_nao_stat_c, ble_nao_stat_c_init_t * p_ble_nao_stat_c_init)
 {
     uint32_t      err_code;
@@ -148,33 +146,6 @@ uint32_t ble_nao_stat_c_init(ble_nao_stat_c_t * p_ble_nao_stat_c, ble_nao_stat_c
 }
 
 
-static void ble_nao_stat_on_write_rsp(ble_nao_stat_c_t * p_ble_nao_stat_c, const ble_evt_t * p_ble_evt)
-{
-    // Check if the event if on the link for this instance
-    if (p_ble_nao_stat_c->conn_handle != p_ble_evt->evt.gattc_evt.conn_handle)
-    {
-        return;
-    }
-
-    if ((p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION) ||
-        (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION))
-    {
-        // Do nothing to reattempt write.
-    }
-    else
-    {
-         if(p_ble_nao_stat_c->conn_handle == p_ble_evt->evt.gap_evt.conn_handle)
-         {
-          NRF_LOG_INFO("Received write response to write request (0x68)\r\n");
-          notif_68_subbed = true;
-         }
-    }
-
-    // Check if there is any message to be sent across to the peer and send it.
-    tx_buffer_process();
-}
-
-
 void ble_nao_stat_c_on_ble_evt(ble_nao_stat_c_t * p_ble_nao_stat_c, const ble_evt_t * p_ble_evt)
 {
     if ((p_ble_nao_stat_c == NULL) || (p_ble_evt == NULL))
@@ -191,10 +162,6 @@ void ble_nao_stat_c_on_ble_evt(ble_nao_stat_c_t * p_ble_nao_stat_c, const ble_ev
 
     switch (p_ble_evt->header.evt_id)
     {
-        case BLE_GATTC_EVT_HVX:
-            ble_nao_stat_on_hvx(p_ble_nao_stat_c, p_ble_evt);
-            break;
-                
         case BLE_GAP_EVT_DISCONNECTED:
             if (p_ble_evt->evt.gap_evt.conn_handle == p_ble_nao_stat_c->conn_handle
                     && p_ble_nao_stat_c->evt_handler != NULL)
@@ -207,11 +174,6 @@ void ble_nao_stat_c_on_ble_evt(ble_nao_stat_c_t * p_ble_nao_stat_c, const ble_ev
                 p_ble_nao_stat_c->evt_handler(p_ble_nao_stat_c, &nao_stat_c_evt);
             }
             break;
-
-         case BLE_GATTC_EVT_WRITE_RSP:
-            //ble_nao_stat_on_write_rsp(p_ble_nao_stat_c, p_ble_evt);
-            break;
-
     }
 }
 
@@ -267,6 +229,10 @@ uint32_t ble_nao_stat_c_handles_assign(ble_nao_stat_c_t * p_ble_nao_stat,
         p_ble_nao_stat->handles.nao_stat_rx_cccd_handle = p_peer_handles->nao_stat_rx_cccd_handle;
         p_ble_nao_stat->handles.nao_stat_rx_handle      = p_peer_handles->nao_stat_rx_handle;
         p_ble_nao_stat->handles.nao_stat_tx_handle      = p_peer_handles->nao_stat_tx_handle;    
+
+        // Notifications of the RX characteristic go straight to this instance.
+        return nao_gattc_dispatch_register(conn_handle, p_peer_handles->nao_stat_rx_handle,
+                                           ble_nao_stat_hvx_dispatch, p_ble_nao_stat);
     }
     return NRF_SUCCESS;
 }
@@ -79,8 +79,6 @@ typedef struct {
     ble_nao_stat_c_evt_handler_t evt_handler;
 } ble_nao_stat_c_init_t;
 
-static bool notif_68_subbed;
-
 void ble_nao_stat_c_on_db_disc_evt(ble_nao_stat_c_t * p_ble_nao_stat_c, ble_db_discovery_evt_t * p_evt);
 uint32_t ble_nao_stat_c_init(ble_nao_stat_c_t * p_ble_nao_stat_c, ble_nao_stat_c_init_t * p_ble_nao_stat_c_init);
 void ble_nao_stat_c_on_ble_evt(ble_nao_stat_c_t * p_ble_nao_stat_c, const ble_evt_t * p_ble_evt);
@@ -0,0 +1,250 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nao_stats.h"
+#include "nao_generic.h"
+#include "nao_pipe.h"
+#include "app_util.h"
+#include "app_util_platform.h"
+
+
+/**@brief Counters of one service. */
+typedef struct
+{
+    uint32_t rx;
+    uint32_t forwarded;
+    uint16_t filtered;
+    uint16_t dropped;
+    uint16_t writes;
+    uint16_t write_fails;
+} stats_srv_t;
+
+/**@brief Counters and state of one link. */
+typedef struct
+{
+    uint16_t connects;
+    uint16_t disconnects;
+    uint8_t  reasons[NAO_STATS_REASONS];   /**< Newest first. */
+    uint32_t reconnect_last_ms;
+    uint32_t reconnect_max_ms;
+    uint32_t disconnect_ms;
+    bool     down;                         /**< Disconnected since disconnect_ms, a reconnect is timed. */
+} stats_link_t;
+
+static nao_proxy_t * mp_nao_proxy;
+static stats_srv_t   m_srv[NAO_STATS_SRV_COUNT];
+static stats_link_t  m_link[NAO_CONN_LINK_COUNT];
+static uint32_t      m_reset_ms;
+
+
+static uint16_t inc16(uint16_t value)
+{
+    return (value < UINT16_MAX) ? (value + 1) : value;
+}
+
+
+void nao_stats_init(nao_proxy_t * p_nao_proxy)
+{
+    mp_nao_proxy = p_nao_proxy;
+    memset(m_srv, 0, sizeof(m_srv));
+    memset(m_link, 0, sizeof(m_link));
+    m_reset_ms = 0;
+}
+
+
+void nao_stats_srv_evt(nao_stats_srv_t srv, nao_stats_evt_t evt)
+{
+    stats_srv_t * p_srv = &m_srv[srv];
+
+    // Counted from the SoftDevice observers and from the main loop.
+    CRITICAL_REGION_ENTER();
+
+    switch (evt)
+    {
+        case NAO_STATS_EVT_RX:
+            p_srv->rx++;
+            break;
+
+        case NAO_STATS_EVT_FORWARDED:
+            p_srv->forwarded++;
+            break;
+
+        case NAO_STATS_EVT_FILTERED:
+            p_srv->filtered = inc16(p_srv->filtered);
+            break;
+
+        case NAO_STATS_EVT_DROPPED:
+            p_srv->dropped = inc16(p_srv->dropped);
+            break;
+
+        case NAO_STATS_EVT_WRITE:
+            p_srv->writes = inc16(p_srv->writes);
+            break;
+
+        case NAO_STATS_EVT_WRITE_FAIL:
+            p_srv->write_fails = inc16(p_srv->write_fails);
+            break;
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+
+void nao_stats_link_connected(nao_conn_link_t link, uint32_t now_ms)
+{
+    stats_link_t * p_link = &m_link[link];
+
+    p_link->connects = inc16(p_link->connects);
+
+    if (p_link->down)
+    {
+        p_link->reconnect_last_ms = now_ms - p_link->disconnect_ms;
+        if (p_link->reconnect_last_ms > p_link->reconnect_max_ms)
+        {
+            p_link->reconnect_max_ms = p_link->reconnect_last_ms;
+        }
+        p_link->down = false;
+    }
+}
+
+
+void nao_stats_link_disconnected(nao_conn_link_t link, uint8_t reason, uint32_t now_ms)
+{
+    stats_link_t * p_link = &m_link[link];
+
+    p_link->disconnects = inc16(p_link->disconnects);
+
+    memmove(&p_link->reasons[1], &p_link->reasons[0], NAO_STATS_REASONS - 1);
+    p_link->reasons[0] = reason;
+
+    p_link->disconnect_ms = now_ms;
+    p_link->down          = true;
+}
+
+
+static uint8_t link_encode(stats_link_t const * p_link, uint8_t * p_buf)
+{
+    uint8_t len = 0;
+
+    len += uint16_encode(p_link->connects, &p_buf[len]);
+    len += uint16_encode(p_link->disconnects, &p_buf[len]);
+    memcpy(&p_buf[len], p_link->reasons, NAO_STATS_REASONS);
+    len += NAO_STATS_REASONS;
+    len += uint32_encode(p_link->reconnect_last_ms, &p_buf[len]);
+    len += uint32_encode(p_link->reconnect_max_ms, &p_buf[len]);
+
+    return len;
+}
+
+
+static uint8_t srv_encode(stats_srv_t const * p_srv, uint8_t * p_buf)
+{
+    uint8_t len = 0;
+
+    len += uint32_encode(p_srv->rx, &p_buf[len]);
+    len += uint32_encode(p_srv->forwarded, &p_buf[len]);
+    len += uint16_encode(p_srv->filtered, &p_buf[len]);
+    len += uint16_encode(p_srv->dropped, &p_buf[len]);
+    len += uint16_encode(p_srv->writes, &p_buf[len]);
+    len += uint16_encode(p_srv->write_fails, &p_buf[len]);
+
+    return len;
+}
+
+
+uint8_t nao_stats_page_encode(uint8_t page, uint32_t now_ms, uint8_t * p_buf)
+{
+    nao_pipe_stats_t const * p_high = nao_pipe_stats_get(NAO_PIPE_PRIO_HIGH);
+    nao_pipe_stats_t const * p_low  = nao_pipe_stats_get(NAO_PIPE_PRIO_LOW);
+    tx_buffer_stats_t        tx_stats;
+    nao_proxy_notif_stats_t  notif_stats;
+    uint8_t                  len;
+
+    if (page >= NAO_STATS_PAGE_COUNT)
+    {
+        return 0;
+    }
+
+    memset(p_buf, 0, NAO_STATS_PAGE_LEN);
+    p_buf[0] = 0x69;
+    p_buf[1] = 0x99;
+    p_buf[2] = page;
+    p_buf[3] = NAO_STATS_PAGE_COUNT;
+    len      = 4;
+
+    switch (page)
+    {
+        case NAO_STATS_PAGE_SYSTEM:
+            len += uint32_encode(now_ms / 1000, &p_buf[len]);
+            len += uint32_encode((now_ms - m_reset_ms) / 1000, &p_buf[len]);
+            len += uint16_encode((p_high->dropped < UINT16_MAX) ? p_high->dropped : UINT16_MAX, &p_buf[len]);
+            len += uint16_encode((p_low->dropped < UINT16_MAX) ? p_low->dropped : UINT16_MAX, &p_buf[len]);
+            p_buf[len++] = p_high->depth_max;
+            p_buf[len++] = p_low->depth_max;
+            break;
+
+        case NAO_STATS_PAGE_LAMP_LINK:
+            len += link_encode(&m_link[NAO_CONN_LINK_LAMP], &p_buf[len]);
+            break;
+
+        case NAO_STATS_PAGE_WATCH_LINK:
+            len += link_encode(&m_link[NAO_CONN_LINK_WATCH], &p_buf[len]);
+            break;
+
+        case NAO_STATS_PAGE_LAMP_QUEUE:
+            tx_buffer_stats_get(&tx_stats);
+            len += uint32_encode(tx_stats.retries, &p_buf[len]);
+            len += uint32_encode(tx_stats.queue_overflows, &p_buf[len]);
+            len += uint32_encode(tx_stats.pool_alloc_failures, &p_buf[len]);
+            p_buf[len++] = tx_stats.pool_in_use;
+            p_buf[len++] = tx_stats.pool_high_water;
+            break;
+
+        case NAO_STATS_PAGE_WATCH_QUEUE:
+            nao_proxy_notif_stats_get(mp_nao_proxy, &notif_stats);
+            len += uint32_encode(notif_stats.superseded, &p_buf[len]);
+            len += uint32_encode(notif_stats.overflow_drops, &p_buf[len]);
+            len += uint32_encode(notif_stats.error_drops, &p_buf[len]);
+            p_buf[len++] = notif_stats.depth;
+            p_buf[len++] = notif_stats.high_water;
+            break;
+
+        case NAO_STATS_PAGE_AUTH:
+            len += srv_encode(&m_srv[NAO_STATS_SRV_AUTH], &p_buf[len]);
+            break;
+
+        case NAO_STATS_PAGE_STAT:
+            len += srv_encode(&m_srv[NAO_STATS_SRV_STAT], &p_buf[len]);
+            break;
+
+        case NAO_STATS_PAGE_CONF:
+            len += srv_encode(&m_srv[NAO_STATS_SRV_CONF], &p_buf[len]);
+            break;
+    }
+
+    // Pages are fixed length, unused bytes stay 0.
+    return NAO_STATS_PAGE_LEN;
+}
+
+
+void nao_stats_reset(uint32_t now_ms)
+{
+    CRITICAL_REGION_ENTER();
+    memset(m_srv, 0, sizeof(m_srv));
+
+    for (uint8_t i = 0; i < NAO_CONN_LINK_COUNT; i++)
+    {
+        m_link[i].connects          = 0;
+        m_link[i].disconnects       = 0;
+        m_link[i].reconnect_last_ms = 0;
+        m_link[i].reconnect_max_ms  = 0;
+        memset(m_link[i].reasons, 0, sizeof(m_link[i].reasons));
+    }
+    CRITICAL_REGION_EXIT();
+
+    tx_buffer_stats_reset();
+    nao_pipe_stats_reset();
+    nao_proxy_notif_stats_reset(mp_nao_proxy);
+
+    m_reset_ms = now_ms;
+}
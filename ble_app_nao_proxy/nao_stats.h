@@ -0,0 +1,84 @@
+#ifndef NAO_STATS_H__
+#define NAO_STATS_H__
+
+#include <stdint.h>
+#include "nao_conn_policy.h"
+#include "nao_proxychar.h"
+
+/**@brief NAO+ services counted separately. */
+typedef enum
+{
+    NAO_STATS_SRV_AUTH,    /**< Service 0x13. */
+    NAO_STATS_SRV_STAT,    /**< Service 0x68. */
+    NAO_STATS_SRV_CONF,    /**< Service 0x09. */
+    NAO_STATS_SRV_COUNT
+} nao_stats_srv_t;
+
+/**@brief Packet events counted per service. */
+typedef enum
+{
+    NAO_STATS_EVT_RX,          /**< Notification received from the lamp. */
+    NAO_STATS_EVT_FORWARDED,   /**< Notification sent on to the watch. */
+    NAO_STATS_EVT_FILTERED,    /**< Notification not sent on, the watch already has its value. */
+    NAO_STATS_EVT_DROPPED,     /**< Notification lost, pipeline full or the watch queue refused it. */
+    NAO_STATS_EVT_WRITE,       /**< Write to the lamp accepted by the SoftDevice. */
+    NAO_STATS_EVT_WRITE_FAIL,  /**< Watch command not written, lamp not connected or TX queue full. */
+} nao_stats_evt_t;
+
+/**@brief Statistics pages sent over the local command channel.
+ *
+ * @details Each page is a 20-byte notification [0x69][0x99][page][page count][16 bytes], values
+ *          little endian:
+ *          - SYSTEM:       uptime s (32), since reset s (32), pipeline drops high/low (16/16), depth max high/low (8/8), 0 (16)
+ *          - LAMP_LINK,
+ *            WATCH_LINK:   connects (16), disconnects (16), last 4 disconnect reasons newest first (4x8),
+ *                          last reconnect ms (32), longest reconnect ms (32)
+ *          - LAMP_QUEUE:   TX retries (32), TX queue overflows (32), packet pool failures (32),
+ *                          pool in use (8), pool high water since boot (8), 0 (16)
+ *          - WATCH_QUEUE:  superseded (32), overflow drops (32), error drops (32), depth (8), high water (8), 0 (16)
+ *          - AUTH, STAT,
+ *            CONF:         received (32), forwarded (32), filtered (16), dropped (16), writes (16), write failures (16)
+ */
+typedef enum
+{
+    NAO_STATS_PAGE_SYSTEM,
+    NAO_STATS_PAGE_LAMP_LINK,
+    NAO_STATS_PAGE_WATCH_LINK,
+    NAO_STATS_PAGE_LAMP_QUEUE,
+    NAO_STATS_PAGE_WATCH_QUEUE,
+    NAO_STATS_PAGE_AUTH,
+    NAO_STATS_PAGE_STAT,
+    NAO_STATS_PAGE_CONF,
+    NAO_STATS_PAGE_COUNT
+} nao_stats_page_t;
+
+#define NAO_STATS_PAGE_LEN     20   /**< Length of an encoded page, one notification on the default ATT MTU. */
+#define NAO_STATS_REASONS      4    /**< Disconnect reasons kept per link. */
+
+/**@brief Function for initializing the statistics.
+ *
+ * @param[in] p_nao_proxy  Proxy service whose notification queue is reported.
+ */
+void nao_stats_init(nao_proxy_t * p_nao_proxy);
+
+/**@brief Function for counting a packet event of a service. */
+void nao_stats_srv_evt(nao_stats_srv_t srv, nao_stats_evt_t evt);
+
+/**@brief Function for noting a new connection, it ends the reconnect time of the link. */
+void nao_stats_link_connected(nao_conn_link_t link, uint32_t now_ms);
+
+/**@brief Function for noting a disconnection and its HCI reason. */
+void nao_stats_link_disconnected(nao_conn_link_t link, uint8_t reason, uint32_t now_ms);
+
+/**@brief Function for encoding a statistics page.
+ *
+ * @param[out] p_buf  NAO_STATS_PAGE_LEN bytes.
+ *
+ * @return Length of the page, 0 if there is no such page.
+ */
+uint8_t nao_stats_page_encode(uint8_t page, uint32_t now_ms, uint8_t * p_buf);
+
+/**@brief Function for clearing the counters, the uptime and the link states are kept. */
+void nao_stats_reset(uint32_t now_ms);
+
+#endif // NAO_STATS_H__
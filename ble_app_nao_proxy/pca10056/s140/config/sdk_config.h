@@ -7887,7 +7887,7 @@
 // <16384=> 16384 
 
 #ifndef NRF_LOG_BUFSIZE
-#define NRF_LOG_BUFSIZE 1024
+#define NRF_LOG_BUFSIZE 4096
 #endif
 
 // <q> NRF_LOG_CLI_CMDS  - Enable CLI commands for the module.
@@ -7906,7 +7906,7 @@
 // <4=> Debug 
 
 #ifndef NRF_LOG_DEFAULT_LEVEL
-#define NRF_LOG_DEFAULT_LEVEL 4
+#define NRF_LOG_DEFAULT_LEVEL 3
 #endif
 
 // <q> NRF_LOG_DEFERRED  - Enable deffered logger.
@@ -7915,7 +7915,7 @@
 // <i> Log data is buffered and can be processed in idle.
 
 #ifndef NRF_LOG_DEFERRED
-#define NRF_LOG_DEFERRED 0
+#define NRF_LOG_DEFERRED 1
 #endif
 
 // <q> NRF_LOG_FILTERS_ENABLED  - Enable dynamic filtering of logs.
@@ -11500,7 +11500,7 @@
 // <i> Requested BLE GAP data length to be negotiated.
 
 #ifndef NRF_SDH_BLE_GAP_DATA_LENGTH
-#define NRF_SDH_BLE_GAP_DATA_LENGTH 27
+#define NRF_SDH_BLE_GAP_DATA_LENGTH 251
 #endif
 
 // <o> NRF_SDH_BLE_PERIPHERAL_LINK_COUNT - Maximum number of peripheral links. 
@@ -11529,7 +11529,7 @@
 
 // <o> NRF_SDH_BLE_GATT_MAX_MTU_SIZE - Static maximum MTU size. 
 #ifndef NRF_SDH_BLE_GATT_MAX_MTU_SIZE
-#define NRF_SDH_BLE_GATT_MAX_MTU_SIZE 23
+#define NRF_SDH_BLE_GATT_MAX_MTU_SIZE 247
 #endif
 
 // <o> NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE - Attribute Table size in bytes. The size must be a multiple of 4. 
@@ -12096,6 +12096,272 @@
 //==========================================================
 
 
+// </e>
+
+// </h> 
+//==========================================================
+
+// <h> nao_proxy - NAO+ proxy modules
+
+//==========================================================
+// <e> NAO_GENERIC_CONFIG_LOG_ENABLED - Enables logging in nao_generic, the NAO+ client TX queue.
+//==========================================================
+#ifndef NAO_GENERIC_CONFIG_LOG_ENABLED
+#define NAO_GENERIC_CONFIG_LOG_ENABLED 1
+#endif
+// <o> NAO_GENERIC_CONFIG_LOG_LEVEL  - Default Severity level
+ 
+// <i> Per-packet messages are Debug, they are compiled out below level 4.
+// <0=> Off 
+// <1=> Error 
+// <2=> Warning 
+// <3=> Info 
+// <4=> Debug 
+
+#ifndef NAO_GENERIC_CONFIG_LOG_LEVEL
+#define NAO_GENERIC_CONFIG_LOG_LEVEL 3
+#endif
+
+// <o> NAO_GENERIC_CONFIG_INFO_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_GENERIC_CONFIG_INFO_COLOR
+#define NAO_GENERIC_CONFIG_INFO_COLOR 0
+#endif
+
+// <o> NAO_GENERIC_CONFIG_DEBUG_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_GENERIC_CONFIG_DEBUG_COLOR
+#define NAO_GENERIC_CONFIG_DEBUG_COLOR 0
+#endif
+
+// </e>
+
+// <e> NAO_AUTH_C_CONFIG_LOG_ENABLED - Enables logging in the NAO+ service 0x13 (AUTH) client.
+//==========================================================
+#ifndef NAO_AUTH_C_CONFIG_LOG_ENABLED
+#define NAO_AUTH_C_CONFIG_LOG_ENABLED 1
+#endif
+// <o> NAO_AUTH_C_CONFIG_LOG_LEVEL  - Default Severity level
+ 
+// <i> Per-packet messages are Debug, they are compiled out below level 4.
+// <0=> Off 
+// <1=> Error 
+// <2=> Warning 
+// <3=> Info 
+// <4=> Debug 
+
+#ifndef NAO_AUTH_C_CONFIG_LOG_LEVEL
+#define NAO_AUTH_C_CONFIG_LOG_LEVEL 3
+#endif
+
+// <o> NAO_AUTH_C_CONFIG_INFO_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_AUTH_C_CONFIG_INFO_COLOR
+#define NAO_AUTH_C_CONFIG_INFO_COLOR 0
+#endif
+
+// <o> NAO_AUTH_C_CONFIG_DEBUG_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_AUTH_C_CONFIG_DEBUG_COLOR
+#define NAO_AUTH_C_CONFIG_DEBUG_COLOR 0
+#endif
+
+// </e>
+
+// <e> NAO_STAT_C_CONFIG_LOG_ENABLED - Enables logging in the NAO+ service 0x68 (STAT) client.
+//==========================================================
+#ifndef NAO_STAT_C_CONFIG_LOG_ENABLED
+#define NAO_STAT_C_CONFIG_LOG_ENABLED 1
+#endif
+// <o> NAO_STAT_C_CONFIG_LOG_LEVEL  - Default Severity level
+ 
+// <i> Per-packet messages are Debug, they are compiled out below level 4.
+// <0=> Off 
+// <1=> Error 
+// <2=> Warning 
+// <3=> Info 
+// <4=> Debug 
+
+#ifndef NAO_STAT_C_CONFIG_LOG_LEVEL
+#define NAO_STAT_C_CONFIG_LOG_LEVEL 3
+#endif
+
+// <o> NAO_STAT_C_CONFIG_INFO_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_STAT_C_CONFIG_INFO_COLOR
+#define NAO_STAT_C_CONFIG_INFO_COLOR 0
+#endif
+
+// <o> NAO_STAT_C_CONFIG_DEBUG_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_STAT_C_CONFIG_DEBUG_COLOR
+#define NAO_STAT_C_CONFIG_DEBUG_COLOR 0
+#endif
+
+// </e>
+
+// <e> NAO_CONF_C_CONFIG_LOG_ENABLED - Enables logging in the NAO+ service 0x09 (CONF) client.
+//==========================================================
+#ifndef NAO_CONF_C_CONFIG_LOG_ENABLED
+#define NAO_CONF_C_CONFIG_LOG_ENABLED 1
+#endif
+// <o> NAO_CONF_C_CONFIG_LOG_LEVEL  - Default Severity level
+ 
+// <i> Per-packet messages are Debug, they are compiled out below level 4.
+// <0=> Off 
+// <1=> Error 
+// <2=> Warning 
+// <3=> Info 
+// <4=> Debug 
+
+#ifndef NAO_CONF_C_CONFIG_LOG_LEVEL
+#define NAO_CONF_C_CONFIG_LOG_LEVEL 3
+#endif
+
+// <o> NAO_CONF_C_CONFIG_INFO_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_CONF_C_CONFIG_INFO_COLOR
+#define NAO_CONF_C_CONFIG_INFO_COLOR 0
+#endif
+
+// <o> NAO_CONF_C_CONFIG_DEBUG_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_CONF_C_CONFIG_DEBUG_COLOR
+#define NAO_CONF_C_CONFIG_DEBUG_COLOR 0
+#endif
+
+// </e>
+
+// <e> NAO_PROXY_CONFIG_LOG_ENABLED - Enables logging in the proxy service for the watch.
+//==========================================================
+#ifndef NAO_PROXY_CONFIG_LOG_ENABLED
+#define NAO_PROXY_CONFIG_LOG_ENABLED 1
+#endif
+// <o> NAO_PROXY_CONFIG_LOG_LEVEL  - Default Severity level
+ 
+// <i> Per-packet messages are Debug, they are compiled out below level 4.
+// <0=> Off 
+// <1=> Error 
+// <2=> Warning 
+// <3=> Info 
+// <4=> Debug 
+
+#ifndef NAO_PROXY_CONFIG_LOG_LEVEL
+#define NAO_PROXY_CONFIG_LOG_LEVEL 3
+#endif
+
+// <o> NAO_PROXY_CONFIG_INFO_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_PROXY_CONFIG_INFO_COLOR
+#define NAO_PROXY_CONFIG_INFO_COLOR 0
+#endif
+
+// <o> NAO_PROXY_CONFIG_DEBUG_COLOR  - ANSI escape code prefix.
+ 
+// <0=> Default 
+// <1=> Black 
+// <2=> Red 
+// <3=> Green 
+// <4=> Yellow 
+// <5=> Blue 
+// <6=> Magenta 
+// <7=> Cyan 
+// <8=> White 
+
+#ifndef NAO_PROXY_CONFIG_DEBUG_COLOR
+#define NAO_PROXY_CONFIG_DEBUG_COLOR 0
+#endif
+
 // </e>
 
 // </h> 